@@ -0,0 +1,85 @@
+/**************************************************************
+ * AdaptiveInterval: change-driven sampling interval per channel
+ *
+ *  - each sample's step |x - previous| feeds an exponentially
+ *    weighted mean ("activity", a cheap variance proxy)
+ *  - a step above changeBand, or well above the recent activity,
+ *    snaps the interval to minMs
+ *  - while activity stays within quietBand the interval doubles
+ *    every sample, up to maxMs
+ *
+ *  Integer only; values are in the channel's fixed-point unit.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+static const uint8_t ADAPT_ACTIVITY_SHIFT = 2;   // EW weight 1/4
+static const uint8_t ADAPT_SPIKE_FACTOR   = 4;   // step > 4x activity = change
+
+class AdaptiveInterval {
+public:
+  AdaptiveInterval(uint32_t minMs, uint32_t maxMs, int32_t quietBand, int32_t changeBand)
+    : lo(minMs), hi(maxMs), quiet(quietBand), change(changeBand), iv(minMs) {}
+
+  void setBounds(uint32_t minMs, uint32_t maxMs){
+    lo = minMs;
+    hi = (maxMs < minMs) ? minMs : maxMs;
+    if (iv < lo) iv = lo;
+    if (iv > hi) iv = hi;
+  }
+
+  // `slack` absorbs jitter of a periodic caller: with ticks nominally
+  // iv apart but measured at iv - 1, a plain >= would skip one.
+  // Pass half the caller's period.
+  bool due(uint32_t now, uint32_t slack = 0) const {
+    return !primed || (now - lastMs) + slack >= iv;
+  }
+
+  // Record a sample taken at `now` and retune the interval.
+  void update(uint32_t now, int32_t x){
+    int32_t step = (x > prev) ? (x - prev) : (prev - x);
+    prev = x;
+    updateStep(now, step);
+  }
+
+  // Same, for a caller that measures the change itself (e.g. the
+  // largest step of several inputs). The first sample only primes.
+  void updateStep(uint32_t now, int32_t step){
+    lastMs = now;
+    if (!primed) {
+      primed = true;
+      return;
+    }
+
+    bool spike = step > change || step > (int32_t)ADAPT_SPIKE_FACTOR * activity + quiet;
+    activity += (step - activity) >> ADAPT_ACTIVITY_SHIFT;
+
+    if (spike) {
+      iv = lo;
+      changes++;
+    } else if (activity <= quiet && iv < hi) {
+      iv = (iv > hi / 2) ? hi : iv * 2;
+    }
+  }
+
+  // Force the next due() (e.g. after a config change)
+  void kick(){ primed = false; iv = lo; }
+
+  uint32_t intervalMs() const { return iv; }
+  uint32_t minMs() const { return lo; }
+  uint32_t maxMs() const { return hi; }
+  int32_t  activityLevel() const { return activity; }
+  uint32_t changeCount() const { return changes; }
+
+private:
+  uint32_t lo, hi;
+  int32_t quiet, change;
+
+  uint32_t iv;
+  uint32_t lastMs = 0;
+  int32_t prev = 0;
+  int32_t activity = 0;
+  uint32_t changes = 0;
+  bool primed = false;
+};
@@ -0,0 +1,104 @@
+/**************************************************************
+ * AdcCalLut: characterised ADC code -> probe voltage table
+ *
+ *  - built once at boot from the chip's eFuse ADC
+ *    characterisation (esp_adc_cal), divider ratio folded in
+ *  - 33 breakpoints (every 128 codes) in integer probe mV,
+ *    linear interpolation between them
+ *  - lookup is integer only and accepts oversampled codes
+ *    (12 + n bits), returning probe microvolts
+ *
+ *  Off-target the table is built from the ideal 0..3.3 V line.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <esp_adc_cal.h>
+#endif
+
+static const uint8_t  ADC_LUT_STEP_BITS = 7;                          // 128 codes per segment
+static const size_t   ADC_LUT_POINTS    = (4096 >> ADC_LUT_STEP_BITS) + 1;
+
+enum AdcCalSource : uint8_t {
+  ADC_CAL_IDEAL = 0,        // no characterisation (host / failure)
+  ADC_CAL_DEFAULT_VREF,
+  ADC_CAL_EFUSE_VREF,
+  ADC_CAL_EFUSE_TP,
+  ADC_CAL_EFUSE_TP_FIT
+};
+
+/**************************************************************
+ * CHARACTERISATION (one per ADC unit/attenuation)
+ **************************************************************/
+class AdcCharacterisation {
+public:
+  AdcCalSource begin(){
+#ifdef ARDUINO
+    esp_adc_cal_value_t v = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11,
+                                                     ADC_WIDTH_BIT_12, 1100, &chars);
+    switch (v) {
+      case ESP_ADC_CAL_VAL_EFUSE_VREF:   src = ADC_CAL_EFUSE_VREF; break;
+      case ESP_ADC_CAL_VAL_EFUSE_TP:     src = ADC_CAL_EFUSE_TP; break;
+      case ESP_ADC_CAL_VAL_DEFAULT_VREF: src = ADC_CAL_DEFAULT_VREF; break;
+      default:                           src = ADC_CAL_EFUSE_TP_FIT; break;
+    }
+#else
+    src = ADC_CAL_IDEAL;
+#endif
+    return src;
+  }
+
+  // Pin millivolts for a 12-bit code (boot-time only)
+  uint32_t codeToMilliVolts(uint32_t code) const {
+#ifdef ARDUINO
+    if (src != ADC_CAL_IDEAL) return esp_adc_cal_raw_to_voltage(code, &chars);
+#endif
+    return (code * 3300u + 2047u) / 4095u;
+  }
+
+  AdcCalSource source() const { return src; }
+
+private:
+  AdcCalSource src = ADC_CAL_IDEAL;
+#ifdef ARDUINO
+  esp_adc_cal_characteristics_t chars;
+#endif
+};
+
+/**************************************************************
+ * LOOKUP TABLE (one per channel, divider folded in)
+ **************************************************************/
+class AdcCalLut {
+public:
+  // ratio: probe volts per pin volt (voltage divider)
+  void build(const AdcCharacterisation &c, float ratio){
+    for (size_t i = 0; i < ADC_LUT_POINTS; i++) {
+      uint32_t mv = c.codeToMilliVolts((uint32_t)(i << ADC_LUT_STEP_BITS));
+      float p = mv * ratio + 0.5f;
+      mvProbe[i] = (p > 65535.0f) ? 65535 : (uint16_t)p;
+    }
+  }
+
+  // code: ADC code with `bits` of resolution (>= 12)
+  uint32_t microVolts(uint32_t code, uint8_t bits) const {
+    uint8_t shift = ADC_LUT_STEP_BITS + (bits - 12);
+    uint32_t idx  = code >> shift;
+    if (idx >= ADC_LUT_POINTS - 1) return (uint32_t)mvProbe[ADC_LUT_POINTS - 1] * 1000u;
+
+    uint32_t frac = code & ((1u << shift) - 1);
+    uint32_t lo = mvProbe[idx];
+    uint32_t hi = mvProbe[idx + 1];
+    uint32_t uv = lo * 1000u;
+    if (hi >= lo) uv += (uint32_t)(((uint64_t)(hi - lo) * 1000u * frac) >> shift);
+    else          uv -= (uint32_t)(((uint64_t)(lo - hi) * 1000u * frac) >> shift);
+    return uv;
+  }
+
+  uint16_t point(size_t i) const { return mvProbe[i]; }
+
+private:
+  uint16_t mvProbe[ADC_LUT_POINTS];
+};
@@ -0,0 +1,149 @@
+/**************************************************************
+ * AdcFilter<N>: per-channel filter chain for raw ADC codes
+ *
+ *  raw -> hampel gate (raw sample vs median/MAD of the window;
+ *         an outlier enters the window as the median instead)
+ *      -> running median (window N), the stage output
+ *      -> optional oversample/decimate (4^n samples -> +n bits)
+ *      -> integer EMA / first-order IIR
+ *
+ *  Integer only, no heap, fixed O(N) work per sample.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const uint8_t ADC_FILTER_IN_BITS  = 12;
+static const uint8_t ADC_FILTER_MAX_OS   = 4;    // 12 -> 16 bit
+
+template<size_t N>
+class AdcFilter {
+  static_assert(N >= 3 && (N & 1), "AdcFilter window must be odd and >= 3");
+
+public:
+  // emaShift: y += (x - y) >> emaShift   (0 = EMA bypassed), given at
+  //           the input rate; it is reduced by 2 per oversample bit so
+  //           the time constant does not change with the decimation
+  // hampelK : gate at k * 1.5 * MAD      (0 = gate bypassed)
+  // minDev  : gate floor in LSB so a flat signal does not reject noise
+  explicit AdcFilter(uint8_t emaShift = 3, uint8_t hampelK = 3, uint16_t minDev = 8)
+    : shift(emaShift), k(hampelK), floorDev(minDev) {}
+
+  void reset(){
+    n = 0;
+    pos = 0;
+    primed = false;
+    rejected = 0;
+    osAcc = 0;
+    osCount = 0;
+  }
+
+  // Output gets ADC_FILTER_IN_BITS + bits of resolution. Restarts the
+  // chain because previous output is on a different scale.
+  void setOversampleBits(uint8_t bits){
+    if (bits > ADC_FILTER_MAX_OS) bits = ADC_FILTER_MAX_OS;
+    osBits = bits;
+    reset();
+  }
+
+  uint8_t oversampleBits() const { return osBits; }
+  uint8_t outputBits() const { return ADC_FILTER_IN_BITS + osBits; }
+
+  // Feed one raw sample; returns the current filter output.
+  uint16_t push(uint16_t x){
+    // gate against the window as it was before this sample
+    if (k && n == N) {
+      uint16_t med = median();
+      uint32_t thr = ((uint32_t)k * mad(med) * 3) / 2;
+      if (thr < floorDev) thr = floorDev;
+      uint16_t dev = (x > med) ? (x - med) : (med - x);
+      if (dev > thr) { x = med; rejected++; }
+    }
+    insert(x);
+
+    uint16_t v = median();
+
+    if (osBits) {
+      osAcc += v;
+      if (++osCount < (1u << (2 * osBits))) return value();
+      v = (uint16_t)(osAcc >> osBits);
+      osAcc = 0;
+      osCount = 0;
+    }
+
+    if (!primed) {
+      y = (int32_t)v << FRAC;
+      primed = true;
+    } else {
+      uint8_t sh = (shift > 2 * osBits) ? (uint8_t)(shift - 2 * osBits) : 0;
+      y += (((int32_t)v << FRAC) - y) >> sh;
+    }
+    return value();
+  }
+
+  bool ready() const { return primed; }
+
+  uint16_t value() const {
+    return (uint16_t)((y + (1 << (FRAC - 1))) >> FRAC);
+  }
+
+  uint16_t median() const {
+    return sorted[n / 2];
+  }
+
+  uint32_t rejectedCount() const { return rejected; }
+
+private:
+  static const uint8_t FRAC = 8;   // EMA state is Q.8
+
+  uint16_t ring[N];     // arrival order (for eviction)
+  uint16_t sorted[N];   // same samples, ascending
+  size_t n = 0;
+  size_t pos = 0;
+
+  int32_t y = 0;
+  bool primed = false;
+
+  uint8_t shift;
+  uint8_t k;
+  uint16_t floorDev;
+  uint32_t rejected = 0;
+
+  uint8_t osBits = 0;
+  uint32_t osAcc = 0;
+  uint32_t osCount = 0;
+
+  void insert(uint16_t x){
+    size_t i;
+    if (n == N) {
+      // evict the oldest sample from the sorted view
+      uint16_t old = ring[pos];
+      for (i = 0; i < n && sorted[i] != old; i++) {}
+      for (; i + 1 < n; i++) sorted[i] = sorted[i + 1];
+      n--;
+    }
+    ring[pos] = x;
+    pos = (pos + 1) % N;
+
+    for (i = n; i > 0 && sorted[i - 1] > x; i--) sorted[i] = sorted[i - 1];
+    sorted[i] = x;
+    n++;
+  }
+
+  // Median absolute deviation: walk outward from the median, merging
+  // the left and right deviations in ascending order (sorted[] is sorted).
+  uint16_t mad(uint16_t med) const {
+    size_t mid = n / 2;
+    size_t l = mid;          // next left candidate is sorted[l - 1]
+    size_t r = mid + 1;      // next right candidate is sorted[r]
+    uint16_t d = 0;
+    for (size_t taken = 1; taken <= mid; taken++) {
+      uint16_t dl = (l > 0) ? (uint16_t)(med - sorted[l - 1]) : 0xFFFF;
+      uint16_t dr = (r < n) ? (uint16_t)(sorted[r] - med)     : 0xFFFF;
+      if (dl <= dr) { d = dl; l--; }
+      else          { d = dr; r++; }
+    }
+    return d;
+  }
+};
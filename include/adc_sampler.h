@@ -0,0 +1,268 @@
+/**************************************************************
+ * AdcSampler: continuous (DMA) ADC acquisition
+ *
+ *  - ESP32-C3 DMA ADC driver runs a channel pattern in the
+ *    background; its ring buffer is filled by the ISR
+ *  - poll() drains whatever the driver captured (never waits)
+ *    and splits it into one ring per channel
+ *  - mean() reduces samples that are already in RAM
+ *  - a channel may own several pattern slots (e.g. an analog mux
+ *    input that needs more conversions than EC/level); each slot
+ *    converts at ADC_DMA_SLOT_HZ
+ *
+ *  Off-target (no ARDUINO) the hardware backend is replaced by a
+ *  stub: push raw codes with inject() and the reduction path
+ *  behaves exactly as on the device; injectOverrun() makes the next
+ *  poll() see a driver ring overflow.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <driver/adc.h>
+#endif
+
+/**************************************************************
+ * PER-CHANNEL RING (N must be a power of two)
+ **************************************************************/
+template<size_t N>
+struct AdcRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "AdcRing size must be a power of two");
+
+  uint16_t buf[N];
+  uint32_t written = 0;   // total samples ever pushed (wraps harmlessly)
+
+  void push(uint16_t v){
+    buf[written & (N - 1)] = v;
+    written++;
+  }
+
+  size_t count() const {
+    return written < N ? (size_t)written : N;
+  }
+
+  // back = 0 is the newest sample
+  uint16_t latest(size_t back) const {
+    return buf[(written - 1 - back) & (N - 1)];
+  }
+};
+
+/**************************************************************
+ * SAMPLER
+ **************************************************************/
+static const uint32_t ADC_DMA_SLOT_HZ     = 1000;    // per pattern slot
+static const uint32_t ADC_DMA_STORE_BYTES = 2048;    // driver ring per slot (~0.5 s)
+static const uint32_t ADC_DMA_STORE_MAX   = 16384;
+static const uint32_t ADC_DMA_FRAME_BYTES = 256;     // default bytes per DMA interrupt
+static const uint32_t ADC_DMA_RESULT_BYTES = 4;      // one TYPE2 conversion
+
+#ifdef SOC_ADC_PATT_LEN_MAX
+static const size_t ADC_DMA_PATTERN_MAX = SOC_ADC_PATT_LEN_MAX;
+#else
+static const size_t ADC_DMA_PATTERN_MAX = 8;         // ESP32-C3 pattern table
+#endif
+
+template<size_t CH, size_t RING = 256>
+class AdcSampler {
+public:
+  // pins[i] becomes logical channel i, one pattern slot each
+  bool begin(const int (&pins)[CH]){
+    uint8_t one[CH];
+    for (size_t i = 0; i < CH; i++) one[i] = 1;
+    return begin(pins, one, ADC_DMA_FRAME_BYTES);
+  }
+
+  // slots[i]: pattern entries (share of conversions) for channel i.
+  // frameBytes: DMA bytes per interrupt; smaller frames hand samples
+  // over sooner (multiple of ADC_DMA_RESULT_BYTES).
+  bool begin(const int (&pins)[CH], const uint8_t (&slots)[CH], uint32_t frameBytes){
+    running = false;
+    totalSlots = 0;
+    for (size_t i = 0; i < CH; i++) {
+      hwChan[i] = -1;
+      ring[i].written = 0;
+      slot[i] = slots[i] ? slots[i] : 1;
+      totalSlots += slot[i];
+    }
+    if (totalSlots > ADC_DMA_PATTERN_MAX) return false;
+
+    frame = frameBytes - frameBytes % ADC_DMA_RESULT_BYTES;
+    if (frame < ADC_DMA_RESULT_BYTES) frame = ADC_DMA_RESULT_BYTES;
+    if (frame > ADC_DMA_FRAME_BYTES) frame = ADC_DMA_FRAME_BYTES;
+
+    overruns = 0;
+    running = backendBegin(pins);
+    return running;
+  }
+
+  bool isRunning() const { return running; }
+
+  uint32_t sampleHz() const { return ADC_DMA_SLOT_HZ * totalSlots; }
+  uint32_t channelHz(size_t ch) const { return ADC_DMA_SLOT_HZ * slot[ch]; }
+
+  // Samples of a channel that can still be in the DMA frame being
+  // filled (captured, not yet visible to poll()).
+  uint32_t inFlight(size_t ch) const {
+    uint32_t perFrame = frame / ADC_DMA_RESULT_BYTES;
+    return (perFrame * slot[ch] + totalSlots - 1) / totalSlots;
+  }
+
+  // Drain everything the backend captured since the last call.
+  // Returns the number of samples routed to channel rings.
+  uint32_t poll(){
+    if (!running) return 0;
+    return backendPoll();
+  }
+
+  // Average of the newest n samples of a channel (n is clamped to
+  // what is available). False if the channel has nothing yet.
+  bool mean(size_t ch, size_t n, uint16_t &out) const {
+    if (ch >= CH) return false;
+    const AdcRing<RING> &r = ring[ch];
+    size_t avail = r.count();
+    if (n > avail) n = avail;
+    if (n == 0) return false;
+
+    uint32_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += r.latest(i);
+    out = (uint16_t)((acc + n / 2) / n);
+    return true;
+  }
+
+  // Visit the samples of a channel pushed since `cursor` (oldest first)
+  // and advance the cursor. A consumer that fell more than RING behind
+  // only sees what is still retained.
+  template<typename F>
+  size_t consume(size_t ch, uint32_t &cursor, F fn) const {
+    if (ch >= CH) return 0;
+    const AdcRing<RING> &r = ring[ch];
+    uint32_t fresh = r.written - cursor;
+    if (fresh > r.count()) fresh = (uint32_t)r.count();
+    for (uint32_t i = fresh; i > 0; i--) fn(r.latest(i - 1));
+    cursor = r.written;
+    return fresh;
+  }
+
+  const AdcRing<RING>& channel(size_t ch) const { return ring[ch]; }
+  uint32_t overrunCount() const { return overruns; }
+
+#ifndef ARDUINO
+  // Host stub: feed one raw 12-bit code for a logical channel
+  void inject(size_t ch, uint16_t raw){
+    if (ch < CH) store(ch, raw);
+  }
+
+  // Host stub: the driver ring overflowed before the next poll()
+  void injectOverrun(){ stubOverrun = true; }
+#endif
+
+private:
+  AdcRing<RING> ring[CH];
+  int8_t hwChan[CH];
+  uint8_t slot[CH];
+  size_t totalSlots = CH;
+  uint32_t frame = ADC_DMA_FRAME_BYTES;
+  bool running = false;
+  uint32_t overruns = 0;
+
+  void store(size_t ch, uint16_t raw){
+    ring[ch].push((uint16_t)(raw & 0x0FFF));
+  }
+
+#ifdef ARDUINO
+  uint8_t buf[ADC_DMA_FRAME_BYTES];
+
+  bool backendBegin(const int (&pins)[CH]){
+    adc_digi_pattern_config_t pattern[ADC_DMA_PATTERN_MAX];
+    uint32_t mask = 0;
+
+    for (size_t i = 0; i < CH; i++) {
+      int8_t c = digitalPinToAnalogChannel(pins[i]);
+      if (c < 0) return false;
+      hwChan[i] = c;
+      mask |= BIT(c);
+    }
+
+    // spread each channel's slots over the pattern: EC, LVL, M, M, ...
+    size_t n = 0;
+    for (uint8_t round = 0; n < totalSlots; round++) {
+      for (size_t i = 0; i < CH; i++) {
+        if (round >= slot[i]) continue;
+        pattern[n].atten     = ADC_ATTEN_DB_11;   // same range as analogRead()
+        pattern[n].channel   = (uint8_t)hwChan[i];
+        pattern[n].unit      = 0;                 // ADC1
+        pattern[n].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        n++;
+      }
+    }
+
+    uint32_t store = ADC_DMA_STORE_BYTES * totalSlots;
+    if (store > ADC_DMA_STORE_MAX) store = ADC_DMA_STORE_MAX;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = store;
+    init.conv_num_each_intr = frame;
+    init.adc1_chan_mask     = mask;
+    init.adc2_chan_mask     = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) return false;
+
+    adc_digi_configuration_t cfg = {};
+    cfg.conv_limit_en  = false;
+    cfg.conv_limit_num = 250;
+    cfg.pattern_num    = totalSlots;
+    cfg.adc_pattern    = pattern;
+    cfg.sample_freq_hz = sampleHz();
+    cfg.conv_mode      = ADC_CONV_SINGLE_UNIT_1;
+    cfg.format         = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+
+    if (adc_digi_controller_configure(&cfg) != ESP_OK || adc_digi_start() != ESP_OK) {
+      adc_digi_deinitialize();
+      return false;
+    }
+    return true;
+  }
+
+  uint32_t backendPoll(){
+    uint32_t routed = 0;
+
+    for (;;) {
+      uint32_t got = 0;
+      esp_err_t err = adc_digi_read_bytes(buf, frame, &got, 0);
+
+      // driver ring overflowed: data is still valid, just note it
+      if (err == ESP_ERR_INVALID_STATE) { overruns++; err = ESP_OK; }
+      if (err != ESP_OK || got == 0) break;
+
+      for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t*)&buf[i];
+        if (p->type2.unit != 0) continue;
+        for (size_t ch = 0; ch < CH; ch++) {
+          if (hwChan[ch] == (int8_t)p->type2.channel) {
+            store(ch, (uint16_t)p->type2.data);
+            routed++;
+            break;
+          }
+        }
+      }
+      if (got < frame) break;
+    }
+    return routed;
+  }
+#else
+  bool stubOverrun = false;
+
+  bool backendBegin(const int (&pins)[CH]){
+    for (size_t i = 0; i < CH; i++) hwChan[i] = (int8_t)pins[i];
+    stubOverrun = false;
+    return true;
+  }
+
+  uint32_t backendPoll(){
+    if (stubOverrun) { overruns++; stubOverrun = false; }
+    return 0;
+  }
+#endif
+};
@@ -0,0 +1,187 @@
+/**************************************************************
+ * MuxScanner: round-robin scan of an external analog multiplexer
+ *
+ *  A 74HC4067 / CD4051 style mux puts one of up to 16 inputs on a
+ *  single ADC pin. That pin is an ordinary AdcSampler channel (with
+ *  extra pattern slots), and the scanner walks the mux inputs:
+ *
+ *    select(k) -> drop `discard` samples -> average `dwell` samples
+ *              -> store result[k] -> select(k+1) ...
+ *
+ *  The DMA keeps converting while the select lines switch; the
+ *  samples captured around the switch (still in the DMA frame being
+ *  filled, or taken while the mux output settles) are counted out
+ *  by `discard`, see muxDiscardSamples().
+ *
+ *  Select backends: GpioMuxSelect drives the S0..S3 lines; off-target
+ *  (no ARDUINO) SimMux models a mux with a settling tail so the scan
+ *  path can be exercised on the host through AdcSampler::inject().
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+static const uint8_t MUX_MAX_INPUTS  = 16;
+static const uint8_t MUX_SELECT_BITS = 4;
+
+// Samples to drop after switching: one DMA frame in flight plus the
+// settling time at the mux stream rate (rounded up).
+static inline uint16_t muxDiscardSamples(uint32_t inFlight, uint32_t streamHz, uint32_t settleUs){
+  return (uint16_t)(inFlight + ((uint64_t)streamHz * settleUs + 999999) / 1000000);
+}
+
+/**************************************************************
+ * SELECT BACKENDS
+ **************************************************************/
+#ifdef ARDUINO
+class GpioMuxSelect {
+public:
+  // pins[0] = S0 (LSB). Unused lines may be -1 (smaller muxes).
+  void begin(const int (&pins)[MUX_SELECT_BITS]){
+    for (uint8_t i = 0; i < MUX_SELECT_BITS; i++) {
+      sel[i] = pins[i];
+      if (sel[i] >= 0) {
+        pinMode(sel[i], OUTPUT);
+        digitalWrite(sel[i], LOW);
+      }
+    }
+  }
+
+  void select(uint8_t input){
+    for (uint8_t i = 0; i < MUX_SELECT_BITS; i++) {
+      if (sel[i] >= 0) digitalWrite(sel[i], (input >> i) & 1 ? HIGH : LOW);
+    }
+  }
+
+private:
+  int sel[MUX_SELECT_BITS] = { -1, -1, -1, -1 };
+};
+#else
+// Host stand-in: each input holds a code; after select() the output
+// moves from the old level towards the new one over settleSamples
+// conversions (linear), like an RC on the mux output.
+class SimMux {
+public:
+  explicit SimMux(uint16_t settleSamples) : settle(settleSamples) {}
+
+  void set(uint8_t input, uint16_t code){ if (input < MUX_MAX_INPUTS) level[input] = code; }
+
+  void select(uint8_t input){
+    from = convertLevel();
+    cur = input < MUX_MAX_INPUTS ? input : 0;
+    since = 0;
+    selects++;
+  }
+
+  // One conversion of the mux output
+  uint16_t convert(){
+    uint16_t v = convertLevel();
+    if (since < settle) since++;
+    return v;
+  }
+
+  uint8_t selected() const { return cur; }
+  uint32_t selectCount() const { return selects; }
+
+private:
+  uint16_t level[MUX_MAX_INPUTS] = {};
+  uint16_t settle;
+  uint16_t from = 0;
+  uint16_t since = 0;
+  uint8_t cur = 0;
+  uint32_t selects = 0;
+
+  uint16_t convertLevel() const {
+    if (since >= settle) return level[cur];
+    int32_t d = (int32_t)level[cur] - from;
+    return (uint16_t)(from + d * since / settle);
+  }
+};
+#endif
+
+/**************************************************************
+ * SCANNER
+ **************************************************************/
+template<size_t N, typename Select>
+class MuxScanner {
+  static_assert(N >= 1 && N <= MUX_MAX_INPUTS, "MuxScanner supports 1..16 inputs");
+
+public:
+  explicit MuxScanner(Select &s) : sel(s) {}
+
+  // discardN: samples dropped after every switch; dwellN: samples
+  // averaged per input.
+  void begin(uint16_t discardN, uint16_t dwellN){
+    discard = discardN;
+    dwell = dwellN ? dwellN : 1;
+    cur = 0;
+    acc = 0;
+    got = 0;
+    scans = 0;
+    primed = false;
+    for (size_t i = 0; i < N; i++) { result[i] = 0; updates[i] = 0; }
+    sel.select(0);
+    skip = discard;
+  }
+
+  // Feed the samples captured since the last call (any object with
+  // AdcSampler::consume()). Switches the mux when the current input
+  // has its dwell; returns true when a full pass completed.
+  template<typename Sampler>
+  bool step(const Sampler &adc, size_t adcCh){
+    if (!primed) {
+      // whatever is buffered predates begin()
+      adc.consume(adcCh, cursor, [](uint16_t){});
+      primed = true;
+      return false;
+    }
+
+    bool pass = false;
+    bool switched = false;
+    adc.consume(adcCh, cursor, [&](uint16_t raw){
+      // the rest of this batch was captured before the switch
+      if (switched) return;
+      if (skip) { skip--; return; }
+
+      acc += raw;
+      if (++got < dwell) return;
+
+      result[cur] = (uint16_t)((acc + dwell / 2) / dwell);
+      updates[cur]++;
+      acc = 0;
+      got = 0;
+
+      if (++cur >= N) { cur = 0; scans++; pass = true; }
+      sel.select(cur);
+      skip = discard;
+      switched = true;
+    });
+    return pass;
+  }
+
+  uint16_t value(size_t input) const { return result[input]; }
+  uint32_t updateCount(size_t input) const { return updates[input]; }
+  uint32_t scanCount() const { return scans; }
+  uint8_t current() const { return cur; }
+  uint16_t discardCount() const { return discard; }
+  uint16_t dwellCount() const { return dwell; }
+
+private:
+  Select &sel;
+  uint16_t result[N];
+  uint32_t updates[N];
+  uint32_t cursor = 0;
+  uint32_t acc = 0;
+  uint32_t scans = 0;
+  uint16_t discard = 0;
+  uint16_t dwell = 1;
+  uint16_t skip = 0;
+  uint16_t got = 0;
+  uint8_t cur = 0;
+  bool primed = false;
+};
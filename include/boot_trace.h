@@ -0,0 +1,70 @@
+/**************************************************************
+ * BootTrace: boot phase and milestone timestamps
+ *
+ *  - mark(name) closes a setup() phase: the phase ran from the
+ *    previous mark (or the timer origin) to now
+ *  - reach(id) stamps a milestone the first time it happens
+ *    (first sample, network up, ...); each id must have a single
+ *    writer context, different ids may come from different tasks
+ *
+ *  Times are esp_timer us, which start counting in the startup code
+ *  before setup(), so they leave out the ROM/2nd-stage bootloader.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+static const uint8_t BOOT_MAX_PHASES     = 12;
+static const uint8_t BOOT_MAX_MILESTONES = 8;
+
+static inline uint32_t bootNowUs(){
+#ifdef ARDUINO
+  return (uint32_t)esp_timer_get_time();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+class BootTrace {
+public:
+  // setup() only (before the tasks start)
+  void mark(const char* name){
+    if (n >= BOOT_MAX_PHASES) return;
+    phase[n].name = name;
+    phase[n].endUs = bootNowUs();
+    n++;
+  }
+
+  // true only for the call that stamped the milestone
+  bool reach(uint8_t id){
+    if (id >= BOOT_MAX_MILESTONES || at[id]) return false;
+    at[id] = bootNowUs() | 1;   // 0 = not reached
+    return true;
+  }
+
+  uint8_t phases() const { return n; }
+  const char* phaseName(uint8_t i) const { return phase[i].name; }
+  uint32_t phaseEndUs(uint8_t i) const { return phase[i].endUs; }
+  uint32_t phaseUs(uint8_t i) const { return phase[i].endUs - (i ? phase[i - 1].endUs : 0); }
+
+  bool reached(uint8_t id) const { return id < BOOT_MAX_MILESTONES && at[id]; }
+  uint32_t milestoneUs(uint8_t id) const { return id < BOOT_MAX_MILESTONES ? at[id] : 0; }
+
+private:
+  struct Phase {
+    const char* name;
+    uint32_t endUs;
+  };
+
+  Phase phase[BOOT_MAX_PHASES];
+  uint8_t n = 0;
+  volatile uint32_t at[BOOT_MAX_MILESTONES] = {};
+};
@@ -0,0 +1,94 @@
+/**************************************************************
+ * ButtonTracker: debounce + press timing from edge timestamps
+ *
+ *  The GPIO ISR stamps every edge (esp_timer us) together with the
+ *  level it read and queues it; the tracker replays those edges
+ *  later, so its result does not depend on when the consumer runs:
+ *
+ *    - edges less than `debounce` apart form one burst; the level
+ *      after the burst counts once nothing moved for `debounce`
+ *    - the burst's first edge is the press / release time
+ *    - a burst that ends on the level it started from is a glitch
+ *
+ *  edge() settles the previous burst when the new edge is far
+ *  enough from it; settle() does the same against the clock for the
+ *  last burst. Both return true on a debounced release, with the
+ *  hold time (press edge to release edge).
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One queued GPIO edge
+struct ButtonEdge {
+  uint32_t t_us;     // esp_timer clock, truncated
+  uint8_t btn;
+  uint8_t pressed;   // level after the edge (1 = pressed)
+};
+
+class ButtonTracker {
+public:
+  void begin(uint32_t debounceUs, bool pressedNow, uint32_t nowUs){
+    debounce = debounceUs;
+    stable = cur = pressedNow;
+    busy = false;
+    last = burst = downAt = nowUs;
+    glitches = 0;
+  }
+
+  bool edge(bool pressed, uint32_t tUs, uint32_t &heldUs){
+    // an edge older than one already replayed (e.g. after a resync)
+    if ((int32_t)(tUs - last) < 0) return false;
+
+    bool released = false;
+    if (busy && tUs - last >= debounce) released = commit(heldUs);
+    if (!busy) burst = tUs;
+    busy = true;
+    last = tUs;
+    cur = pressed;
+    return released;
+  }
+
+  bool settle(uint32_t nowUs, uint32_t &heldUs){
+    if (!busy || nowUs - last < debounce) return false;
+    return commit(heldUs);
+  }
+
+  bool pending() const { return busy; }
+  bool pressed() const { return stable; }
+
+  // us until the pending burst can settle (0 if none or due)
+  uint32_t settleInUs(uint32_t nowUs) const {
+    if (!busy) return 0;
+    uint32_t el = nowUs - last;
+    return el < debounce ? debounce - el : 0;
+  }
+
+  uint32_t glitchCount() const { return glitches; }
+
+private:
+  uint32_t debounce = 0;
+  uint32_t last = 0;      // latest edge
+  uint32_t burst = 0;     // first edge of the pending burst
+  uint32_t downAt = 0;    // debounced press time
+  uint32_t glitches = 0;
+  bool stable = false;    // debounced level
+  bool cur = false;       // level after the latest edge
+  bool busy = false;      // burst pending
+
+  bool commit(uint32_t &heldUs){
+    busy = false;
+    if (cur == stable) {
+      glitches++;
+      return false;
+    }
+    stable = cur;
+    if (stable) {
+      downAt = burst;
+      return false;
+    }
+    heldUs = burst - downAt;
+    return true;
+  }
+};
@@ -0,0 +1,149 @@
+/**************************************************************
+ * DeadlineScheduler<N>: periodic jobs ordered by next deadline
+ *
+ *  - fixed-size binary min-heap of job ids keyed by due time
+ *    (millis(), wrap-safe comparisons)
+ *  - runDue() runs what is due and re-arms each job at
+ *    due + period (missed periods are skipped, not replayed)
+ *  - msUntilNext() is how long the owning task may block; a job
+ *    can move its own deadline with runAt() (e.g. to a hardware
+ *    deadline it knows about), the owner can pull one in with
+ *    runBy() when an event makes it due early
+ *
+ *  Not thread-safe: one scheduler per task. Other tasks wake the
+ *  owner with a task notification instead of touching the heap.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const uint32_t SCHED_IDLE_MS = 1000;   // longest sleep with no jobs
+
+template<size_t N>
+class DeadlineScheduler {
+  static_assert(N >= 1 && N <= 32, "DeadlineScheduler holds 1..32 jobs");
+
+public:
+  typedef void (*Job)();
+
+  // Returns the job id, or -1 when full. First run at now + firstDelayMs.
+  int8_t add(Job fn, uint32_t periodMs, uint32_t now, uint32_t firstDelayMs = 0){
+    if (n >= N || !fn) return -1;
+    uint8_t id = n;
+    jobs[id].fn = fn;
+    jobs[id].period = periodMs ? periodMs : 1;
+    jobs[id].due = now + firstDelayMs;
+    jobs[id].runs = 0;
+    heap[n] = id;
+    pos[id] = n;
+    n++;
+    siftUp(pos[id]);
+    return (int8_t)id;
+  }
+
+  // Run each job that is due at `now` (at most once per call).
+  // Returns the number of jobs run.
+  uint8_t runDue(uint32_t now){
+    DirectRun run;
+    return runDue(now, run);
+  }
+
+  // Same, but each job is started through run(id, fn), e.g. to time it
+  template<typename Run>
+  uint8_t runDue(uint32_t now, Run &run){
+    uint8_t ran = 0;
+    while (n && ran < n && before(jobs[heap[0]].due, now + 1)) {
+      uint8_t id = heap[0];
+      Entry &e = jobs[id];
+
+      uint32_t next = e.due + e.period;
+      if (before(next, now + 1)) next = now + e.period;
+      e.due = next;
+      siftDown(0);
+
+      e.runs++;
+      run(id, e.fn);   // may call runAt(id, ...) to override `next`
+      ran++;
+    }
+    return ran;
+  }
+
+  // Move a job's next deadline (earlier or later).
+  void runAt(int8_t id, uint32_t due){
+    if (id < 0 || (uint8_t)id >= n) return;
+    uint32_t old = jobs[id].due;
+    jobs[id].due = due;
+    if (before(due, old)) siftUp(pos[id]);
+    else siftDown(pos[id]);
+  }
+
+  // Pull a job's next deadline in to `due` (no-op if already sooner).
+  void runBy(int8_t id, uint32_t due){
+    if (id < 0 || (uint8_t)id >= n) return;
+    if (before(due, jobs[id].due)) runAt(id, due);
+  }
+
+  // Milliseconds until the earliest deadline (0 if overdue).
+  uint32_t msUntilNext(uint32_t now) const {
+    if (!n) return SCHED_IDLE_MS;
+    int32_t d = (int32_t)(jobs[heap[0]].due - now);
+    return d > 0 ? (uint32_t)d : 0;
+  }
+
+  uint32_t dueAt(int8_t id) const { return jobs[id].due; }
+  uint32_t periodMs(int8_t id) const { return jobs[id].period; }
+  uint32_t runCount(int8_t id) const { return jobs[id].runs; }
+  uint8_t count() const { return n; }
+
+private:
+  struct Entry {
+    Job fn;
+    uint32_t due;
+    uint32_t period;
+    uint32_t runs;
+  };
+
+  Entry jobs[N];
+  uint8_t heap[N];   // heap of job ids
+  uint8_t pos[N];    // job id -> heap index
+  uint8_t n = 0;
+
+  struct DirectRun {
+    void operator()(uint8_t, Job fn){ fn(); }
+  };
+
+  static bool before(uint32_t a, uint32_t b){ return (int32_t)(a - b) < 0; }
+
+  bool less(uint8_t i, uint8_t j) const {
+    return before(jobs[heap[i]].due, jobs[heap[j]].due);
+  }
+
+  void swap(uint8_t i, uint8_t j){
+    uint8_t t = heap[i];
+    heap[i] = heap[j];
+    heap[j] = t;
+    pos[heap[i]] = i;
+    pos[heap[j]] = j;
+  }
+
+  void siftUp(uint8_t i){
+    while (i > 0) {
+      uint8_t p = (uint8_t)((i - 1) / 2);
+      if (!less(i, p)) break;
+      swap(i, p);
+      i = p;
+    }
+  }
+
+  void siftDown(uint8_t i){
+    for (;;) {
+      uint8_t l = (uint8_t)(2 * i + 1), r = (uint8_t)(l + 1), m = i;
+      if (l < n && less(l, m)) m = l;
+      if (r < n && less(r, m)) m = r;
+      if (m == i) break;
+      swap(i, m);
+      i = m;
+    }
+  }
+};
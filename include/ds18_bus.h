@@ -0,0 +1,395 @@
+/**************************************************************
+ * Ds18Bus: address-cached DS18B20 driver on one 1-Wire bus
+ *
+ *  - scan() enumerates the bus once and caches ROM codes
+ *  - each ROM keeps its slot: a rescan matches probes to their
+ *    slots instead of refilling the list in search order, so a
+ *    probe dropping out leaves its slot missing rather than moving
+ *    the others up. An unknown probe takes a free slot, else the
+ *    slot of a probe that is missing (replacement); slotVersion()
+ *    changes whenever a slot gets a new ROM. assign() restores the
+ *    table (e.g. from NVS) before begin().
+ *  - conversions are started for all probes at once (SKIP ROM)
+ *  - results are read per probe by address (MATCH ROM), so no
+ *    1-Wire search runs in the normal read path
+ *  - a probe that fails CRC/presence DS18_MISS_LIMIT times in a
+ *    row is marked missing; needsRescan() then asks for a new scan
+ *
+ *  tick() drives a small state machine:
+ *    IDLE --(period elapsed)--> CONVERTING, deadline = t + tconv(bits)
+ *    CONVERTING --(deadline, device released the bus)--> read, IDLE
+ *  so the bus is only touched to start a conversion and when its
+ *  result is due. Resolution adapts: after DS18_STABLE_READS quiet
+ *  reads it steps down towards DS18_MIN_BITS, and any movement of
+ *  at least one quantum (or DS18_MOVE_RAW) snaps it back to 12 bit.
+ *
+ *  Power-on resets are tracked per probe: setResolution() writes
+ *  DS18_TL_MARK into the scratchpad TL byte (not copied to EEPROM).
+ *  A probe that reset reads back its EEPROM TL instead, so its value
+ *  is dropped and the scratchpad is rewritten before the next
+ *  conversion. This also works with parasite power, where the bus
+ *  never shows a conversion in progress.
+ *  A read of 85 C (the power-on scratchpad value) is then accepted
+ *  only if the probe's previous reading was within DS18_POR_NEAR_RAW
+ *  of it, or a second conversion started right away reads 85 again.
+ *
+ *  Temperatures are kept as the raw 1/16 C register value.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <OneWire.h>
+
+static const uint8_t DS18_MAX_PROBES = 3;
+static const uint8_t DS18_SCAN_MAX   = 8;    // devices looked at per search
+static const uint8_t DS18_MISS_LIMIT = 3;
+static const int16_t TEMP_INVALID    = INT16_MIN;
+static const int16_t DS18_RAW_MIN    = -55 * 16;
+static const int16_t DS18_RAW_MAX    = 125 * 16;
+static const int16_t DS18_RAW_POR    = 85 * 16;    // 0x0550, scratchpad after power-on
+static const int16_t DS18_POR_NEAR_RAW = 2 * 16;   // previous reading this close: 85 C is real
+static const uint8_t DS18_TL_MARK    = 0xA5;       // scratchpad TL while we own the config
+
+static const uint8_t DS18_FAMILY_B20 = 0x28;
+static const uint8_t DS18_FAMILY_1822 = 0x22;
+
+static const uint8_t DS18_CMD_CONVERT  = 0x44;
+static const uint8_t DS18_CMD_READ_SP  = 0xBE;
+static const uint8_t DS18_CMD_WRITE_SP = 0x4E;
+
+// Adaptive resolution
+static const uint8_t DS18_MAX_BITS     = 12;
+static const uint8_t DS18_MIN_BITS     = 9;
+static const int16_t DS18_STABLE_RAW   = 2;    // <= 0.125 C between reads is quiet
+static const int16_t DS18_MOVE_RAW     = 4;    // >= 0.25 C is movement
+static const uint8_t DS18_STABLE_READS = 10;   // quiet reads before stepping down
+
+// Conversion deadline handling
+static const uint32_t DS18_CONV_MARGIN_MS = 5;    // on top of datasheet tconv
+static const uint32_t DS18_BUSY_RETRY_MS  = 10;   // device still busy at deadline
+
+struct Ds18Probe {
+  uint8_t rom[8];
+  int16_t raw = TEMP_INVALID;   // 1/16 C
+  int16_t prev = TEMP_INVALID;  // previous good reading (adaptation)
+  bool assigned = false;        // rom is valid; the slot belongs to it
+  bool present = false;
+  uint8_t misses = 0;
+  uint8_t porReads = 0;         // 85 C reads in a row since the last other value
+};
+
+class Ds18Bus {
+public:
+  explicit Ds18Bus(OneWire &bus) : ow(bus) {}
+
+  // Scan, force 12-bit and arm the state machine.
+  void begin(uint32_t periodMs, uint32_t rescanMs){
+    period = periodMs;
+    rescanEvery = rescanMs;
+    scan();
+    setResolution(DS18_MAX_BITS);
+    state = DS_IDLE;
+    started = 0;
+    primed = false;
+  }
+
+  // Call often; touches the bus only when something is due.
+  // Returns true when a new set of readings was collected.
+  bool tick(uint32_t now){
+    if (state == DS_CONVERTING) {
+      if ((int32_t)(now - deadline) < 0) return false;
+
+      // device holds the line low until done (externally powered probes)
+      if (!ow.read_bit() && now - started < 2 * conversionMs(convBits)) {
+        deadline = now + DS18_BUSY_RETRY_MS;
+        return false;
+      }
+
+      readAll();
+      adapt();
+      state = DS_IDLE;
+      return true;
+    }
+
+    if (primed && now - started < period && !recheck) return false;
+    recheck = false;
+
+    if (needsRescan() && (!scanned || now - lastScan >= rescanEvery)) {
+      lastScan = now;
+      scan();
+      setResolution(bits);
+    }
+    if (n == 0) { started = now; primed = true; return false; }
+    if (rewrite) setResolution(bits);   // a probe reset: config and TL mark are gone
+
+    if (requestAll()) {
+      convBits = bits;
+      state = DS_CONVERTING;
+      deadline = now + conversionMs(convBits) + DS18_CONV_MARGIN_MS;
+    }
+    started = now;
+    primed = true;
+    return false;
+  }
+
+  // Slot i belongs to `rom` (not present until a scan finds it).
+  // False if the ROM is not a temperature probe.
+  bool assign(uint8_t i, const uint8_t (&rom)[8]){
+    if (i >= DS18_MAX_PROBES || !validRom(rom)) return false;
+    Ds18Probe &p = probes[i];
+    memcpy(p.rom, rom, sizeof(rom));
+    p.assigned = true;
+    p.present = false;
+    p.raw = TEMP_INVALID;
+    p.prev = TEMP_INVALID;
+    p.misses = 0;
+    p.porReads = 0;
+    updateCount();
+    return true;
+  }
+
+  // Full search; matches the probes found to their slots. Returns the
+  // number of probes present.
+  uint8_t scan(){
+    uint8_t found[DS18_SCAN_MAX][8];
+    uint8_t nFound = 0;
+    ow.reset_search();
+    while (nFound < DS18_SCAN_MAX && ow.search(found[nFound])) {
+      if (validRom(found[nFound])) nFound++;
+    }
+
+    bool seen[DS18_MAX_PROBES] = {};
+    bool placed[DS18_SCAN_MAX] = {};
+    for (uint8_t f = 0; f < nFound; f++) {
+      for (uint8_t i = 0; i < DS18_MAX_PROBES; i++) {
+        if (probes[i].assigned && memcmp(probes[i].rom, found[f], 8) == 0) {
+          seen[i] = placed[f] = true;
+          break;
+        }
+      }
+    }
+
+    // unknown probes: free slots first, then slots of missing probes
+    for (uint8_t f = 0; f < nFound; f++) {
+      if (placed[f]) continue;
+      int8_t slot = -1;
+      for (uint8_t i = 0; i < DS18_MAX_PROBES && slot < 0; i++) if (!probes[i].assigned) slot = i;
+      for (uint8_t i = 0; i < DS18_MAX_PROBES && slot < 0; i++) if (!seen[i]) slot = i;
+      if (slot < 0) break;   // more probes than slots
+
+      Ds18Probe &p = probes[slot];
+      memcpy(p.rom, found[f], 8);
+      p.assigned = true;
+      p.raw = TEMP_INVALID;
+      p.prev = TEMP_INVALID;
+      p.porReads = 0;
+      seen[slot] = true;
+      slotChanges++;
+    }
+
+    uint8_t present = 0;
+    for (uint8_t i = 0; i < DS18_MAX_PROBES; i++) {
+      Ds18Probe &p = probes[i];
+      if (seen[i]) {
+        if (!p.present) p.misses = 0;
+        p.present = true;
+        present++;
+      } else {
+        p.present = false;
+        p.raw = TEMP_INVALID;
+        p.prev = TEMP_INVALID;
+      }
+    }
+    updateCount();
+    scans++;
+    scanned = true;
+    return present;
+  }
+
+  // Start a conversion on every probe at once.
+  bool requestAll(){
+    if (!ow.reset()) return false;
+    ow.skip();
+    ow.write(DS18_CMD_CONVERT);
+    return true;
+  }
+
+  // Same resolution for every probe (they convert together).
+  bool setResolution(uint8_t b){
+    if (b < DS18_MIN_BITS) b = DS18_MIN_BITS;
+    if (b > DS18_MAX_BITS) b = DS18_MAX_BITS;
+    if (!ow.reset()) return false;
+    ow.skip();
+    ow.write(DS18_CMD_WRITE_SP);
+    ow.write(0x4B);                                      // TH (factory default)
+    ow.write(DS18_TL_MARK);                              // TL, see reset tracking above
+    ow.write((uint8_t)(((b - 9) << 5) | 0x1F));          // config
+    bits = b;
+    rewrite = false;
+    return true;
+  }
+
+  // Read the scratchpad of probe i by address. False on no presence,
+  // bad CRC or a power-on value; the previous value is kept until the
+  // probe is missing.
+  bool read(uint8_t i){
+    if (i >= n || !probes[i].assigned) return false;
+    Ds18Probe &p = probes[i];
+
+    uint8_t sp[9];
+    bool ok = ow.reset();
+    if (ok) {
+      ow.select(p.rom);
+      ow.write(DS18_CMD_READ_SP);
+      ow.read_bytes(sp, sizeof(sp));
+      // all-zero scratchpad passes CRC; config byte low bits are always 1
+      ok = (OneWire::crc8(sp, 8) == sp[8]) && ((sp[4] & 0x1F) == 0x1F);
+    }
+
+    if (!ok) {
+      if (p.misses < 255) p.misses++;
+      if (p.misses >= DS18_MISS_LIMIT) {
+        p.present = false;
+        p.raw = TEMP_INVALID;
+        p.prev = TEMP_INVALID;
+      }
+      return false;
+    }
+
+    p.misses = 0;
+    p.present = true;
+
+    // reset since the last setResolution(): the value predates our
+    // conversion (85 C) and the resolution is the EEPROM one
+    if (sp[3] != DS18_TL_MARK) {
+      rewrite = true;
+      p.porReads = 0;
+      return false;
+    }
+
+    int16_t raw = (int16_t)((sp[1] << 8) | sp[0]);
+    raw &= (int16_t)~((1 << (DS18_MAX_BITS - convBits)) - 1);   // undefined low bits
+    if (raw < DS18_RAW_MIN || raw > DS18_RAW_MAX) return false;
+    if (raw == DS18_RAW_POR) {
+      if (p.porReads < 255) p.porReads++;
+      if (!porConfirmed(p)) {
+        recheck = true;   // convert again without waiting for the period
+        return false;
+      }
+    } else {
+      p.porReads = 0;
+    }
+    p.prev = p.raw;
+    p.raw = raw;
+    return true;
+  }
+
+  uint8_t readAll(){
+    uint8_t ok = 0;
+    for (uint8_t i = 0; i < n; i++) if (read(i)) ok++;
+    return ok;
+  }
+
+  bool needsRescan() const {
+    if (n == 0) return true;
+    for (uint8_t i = 0; i < n; i++) if (probes[i].assigned && !probes[i].present) return true;
+    return false;
+  }
+
+  // When tick() next has bus work to do (for a deadline scheduler)
+  uint32_t nextDue(uint32_t now) const {
+    if (state == DS_CONVERTING) return deadline;
+    if (!primed || recheck) return now;
+    return started + period;
+  }
+
+  // Conversion start-to-start period (adaptive sampling)
+  void setPeriod(uint32_t ms){ period = ms; }
+  uint32_t periodMs() const { return period; }
+
+  // Slots in use: the highest assigned slot + 1 (some may be missing)
+  uint8_t count() const { return n; }
+  const Ds18Probe& probe(uint8_t i) const { return probes[i]; }
+  uint32_t scanCount() const { return scans; }
+  uint32_t slotVersion() const { return slotChanges; }
+  uint8_t resolution() const { return bits; }
+
+  // Datasheet max conversion time: 93.75 ms at 9 bit, doubling per bit
+  static uint32_t conversionMs(uint8_t b){
+    return (750u >> (DS18_MAX_BITS - b)) + 1;
+  }
+
+  // 1/16 C register value -> 1/100 C
+  static int16_t rawToCx100(int16_t raw){
+    if (raw == TEMP_INVALID) return TEMP_INVALID;
+    return (int16_t)(((int32_t)raw * 25) / 4);
+  }
+
+private:
+  enum State : uint8_t { DS_IDLE = 0, DS_CONVERTING };
+
+  OneWire &ow;
+  Ds18Probe probes[DS18_MAX_PROBES];
+  uint8_t n = 0;
+  uint32_t scans = 0;
+  uint32_t slotChanges = 0;
+
+  State state = DS_IDLE;
+  uint8_t bits = DS18_MAX_BITS;       // resolution of the next conversion
+  uint8_t convBits = DS18_MAX_BITS;   // resolution of the one in flight
+  uint8_t stableReads = 0;
+  uint32_t period = 1000;
+  uint32_t rescanEvery = 10000;
+  uint32_t started = 0;
+  uint32_t deadline = 0;
+  uint32_t lastScan = 0;
+  bool primed = false;
+  bool scanned = false;
+  bool rewrite = false;               // a probe lost its scratchpad config
+  bool recheck = false;               // start the next conversion at once
+
+  // 85 C from this probe is a temperature: two conversions in a row
+  // read it, or its previous reading was close
+  static bool porConfirmed(const Ds18Probe &p){
+    if (p.porReads >= 2) return true;
+    if (p.raw == TEMP_INVALID) return false;
+    int16_t d = (p.raw > DS18_RAW_POR) ? (p.raw - DS18_RAW_POR) : (DS18_RAW_POR - p.raw);
+    return d <= DS18_POR_NEAR_RAW;
+  }
+
+  static bool validRom(const uint8_t (&rom)[8]){
+    if (OneWire::crc8(rom, 7) != rom[7]) return false;
+    return rom[0] == DS18_FAMILY_B20 || rom[0] == DS18_FAMILY_1822;
+  }
+
+  void updateCount(){
+    n = 0;
+    for (uint8_t i = 0; i < DS18_MAX_PROBES; i++) if (probes[i].assigned) n = i + 1;
+  }
+
+  void adapt(){
+    int16_t quantum = (int16_t)(1 << (DS18_MAX_BITS - convBits));
+    int16_t moveAt = quantum > DS18_MOVE_RAW ? quantum : DS18_MOVE_RAW;
+    int16_t maxDelta = -1;
+
+    for (uint8_t i = 0; i < n; i++) {
+      const Ds18Probe &p = probes[i];
+      if (p.raw == TEMP_INVALID || p.prev == TEMP_INVALID) continue;
+      int16_t d = (p.raw > p.prev) ? (p.raw - p.prev) : (p.prev - p.raw);
+      if (d > maxDelta) maxDelta = d;
+    }
+    if (maxDelta < 0) return;   // nothing to compare yet
+
+    if (maxDelta >= moveAt) {
+      stableReads = 0;
+      if (bits != DS18_MAX_BITS) setResolution(DS18_MAX_BITS);
+      return;
+    }
+
+    if (maxDelta <= DS18_STABLE_RAW && ++stableReads >= DS18_STABLE_READS) {
+      stableReads = 0;
+      if (bits > DS18_MIN_BITS) setResolution(bits - 1);
+    }
+  }
+};
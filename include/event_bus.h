@@ -0,0 +1,123 @@
+/**************************************************************
+ * EventBus: typed events over lock-free SPSC rings
+ *
+ *  SpscRing<T, N>
+ *    - one producer context, one consumer context
+ *    - free-running head/tail indices, N a power of two
+ *    - plain atomic loads/stores only (no RMW), which the
+ *      ESP32-C3 (RV32IMC, no 'A' extension) does natively
+ *
+ *  EventBus<Ev, P, C, N>
+ *    - a ring for every (producer, consumer) pair, so every ring
+ *      stays single-producer/single-consumer: a producer id is a
+ *      context (task or timer task), not a subsystem
+ *    - consumers subscribe to event kinds (Ev::kind, bit mask);
+ *      publish() copies the event into each subscriber's ring and
+ *      calls wake(consumer) once per subscriber
+ *    - a full ring drops the new event and counts it
+ *
+ *  Subscriptions are set up at boot, before the first publish().
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template<typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  // Producer side
+  bool push(const T &v){
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) {
+      drops++;
+      return false;
+    }
+    buf[h & (N - 1)] = v;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T &out){
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    out = buf[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate from any other context
+  uint32_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint32_t dropCount() const { return drops; }
+
+private:
+  T buf[N];
+  std::atomic<uint32_t> head{0};   // written by the producer
+  std::atomic<uint32_t> tail{0};   // written by the consumer
+  volatile uint32_t drops = 0;     // producer
+};
+
+template<typename Ev, size_t P, size_t C, size_t N>
+class EventBus {
+  static_assert(P >= 1 && C >= 1 && C <= 32, "EventBus needs producers and 1..32 consumers");
+
+public:
+  typedef void (*Wake)(uint8_t consumer);
+
+  void begin(Wake w){ wake = w; }
+
+  // kinds: bit (1 << Ev::kind) per accepted kind
+  void subscribe(uint8_t consumer, uint32_t kinds){
+    if (consumer < C) mask[consumer] |= kinds;
+  }
+
+  // From producer context `producer` only. True if every subscriber
+  // got the event.
+  bool publish(uint8_t producer, const Ev &e){
+    if (producer >= P) return false;
+    bool ok = true;
+    const uint32_t bit = 1u << e.kind;
+    for (uint8_t c = 0; c < C; c++) {
+      if (!(mask[c] & bit)) continue;
+      ok &= ring[producer][c].push(e);
+      if (wake) wake(c);
+    }
+    return ok;
+  }
+
+  // From consumer context `consumer` only. Producers are taken in
+  // turn, so a busy producer cannot starve the others.
+  bool poll(uint8_t consumer, Ev &out){
+    if (consumer >= C) return false;
+    for (uint8_t i = 0; i < P; i++) {
+      uint8_t p = next[consumer];
+      next[consumer] = (uint8_t)((p + 1) % P);
+      if (ring[p][consumer].pop(out)) return true;
+    }
+    return false;
+  }
+
+  uint32_t depth(uint8_t consumer) const {
+    uint32_t d = 0;
+    for (uint8_t p = 0; p < P; p++) d += ring[p][consumer].size();
+    return d;
+  }
+
+  uint32_t drops(uint8_t consumer) const {
+    uint32_t d = 0;
+    for (uint8_t p = 0; p < P; p++) d += ring[p][consumer].dropCount();
+    return d;
+  }
+
+private:
+  SpscRing<Ev, N> ring[P][C];
+  uint32_t mask[C] = {};
+  uint8_t next[C] = {};   // consumer-owned round-robin cursor
+  Wake wake = nullptr;
+};
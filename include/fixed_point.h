@@ -0,0 +1,55 @@
+/**************************************************************
+ * Fixed-point helpers for the sensor pipeline
+ *
+ *  The ESP32-C3 core has no FPU, so the per-tick path works in
+ *  integers: voltages in uV, EC in uS/cm, level in milli-units,
+ *  percentages in 1/100 %. Float is only used at the edges
+ *  (JSON, LCD, NVS) through fxToFloat()/fxFromFloat().
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+/**************************************************************
+ * LINEAR MAP  y = slope * x + offset,  slope in Q32.32
+ *  - one 32x64 multiply + shift per apply(), no division
+ *  - fit() divides once, at calibration time
+ **************************************************************/
+struct LinearQ32 {
+  int64_t slope = 0;    // dy/dx, Q32.32
+  int32_t offset = 0;   // y at x = 0
+
+  // False (map untouched) if the two points share x
+  bool fit(int32_t x0, int32_t y0, int32_t x1, int32_t y1){
+    int32_t dx = x1 - x0;
+    if (dx == 0) return false;
+    slope  = ((int64_t)(y1 - y0) * ((int64_t)1 << 32)) / dx;
+    offset = y0 - mulQ32(x0);
+    return true;
+  }
+
+  int32_t apply(int32_t x) const {
+    return mulQ32(x) + offset;
+  }
+
+private:
+  int32_t mulQ32(int32_t x) const {
+    return (int32_t)((slope * x + ((int64_t)1 << 31)) >> 32);
+  }
+};
+
+/**************************************************************
+ * EDGE CONVERSIONS (JSON / LCD / NVS only)
+ **************************************************************/
+static inline float fxToFloat(int32_t v, int32_t scale){
+  return (float)v / (float)scale;
+}
+
+static inline int32_t fxFromFloat(float f, int32_t scale){
+  float s = f * (float)scale;
+  return (int32_t)(s < 0 ? s - 0.5f : s + 0.5f);
+}
+
+static inline int32_t fxClamp(int32_t v, int32_t lo, int32_t hi){
+  return v < lo ? lo : (v > hi ? hi : v);
+}
@@ -0,0 +1,125 @@
+/**************************************************************
+ * LcdPending: writer-side frame for a queued character LCD
+ *
+ *  Render code posts LcdOps (a run of text at row/col, or the
+ *  backlight state) into a bounded queue and returns; the writer
+ *  task pops them into LcdPending and then writes to the display:
+ *
+ *    - `image` is the frame the display should show; each op is
+ *      copied in and its cells are marked dirty (one bit per cell)
+ *    - an op that lands on cells that are still dirty supersedes the
+ *      older text, which is never sent (counted as coalesced)
+ *    - flush() sends dirty cells as runs, bridging single clean
+ *      cells like LcdShadow; a failed write stops the flush and
+ *      leaves the rest dirty
+ *    - invalidate() marks everything dirty, e.g. after the display
+ *      was re-initialised by a bus recovery
+ *
+ *  Sink: any type with
+ *    bool run(uint8_t col, uint8_t row, const char* s, uint8_t n);
+ *
+ *  Writer task only.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "lcd_shadow.h"
+
+static const uint8_t LCD_OP_TEXT = 20;   // one 20-column line
+
+enum LcdOpKind : uint8_t { LCD_OP_RUN=0, LCD_OP_BACKLIGHT=1 };
+
+struct LcdOp {
+  uint8_t kind;    // LcdOpKind
+  uint8_t row;
+  uint8_t col;
+  uint8_t n;       // LCD_OP_RUN: text length; LCD_OP_BACKLIGHT: 1 = on
+  char text[LCD_OP_TEXT];
+};
+
+template<uint8_t COLS, uint8_t ROWS>
+class LcdPending {
+  static_assert(COLS <= 32, "LcdPending keeps one dirty bit per column in a uint32_t");
+
+public:
+  LcdPending(){
+    memset(image, ' ', sizeof(image));
+    invalidate();
+  }
+
+  void apply(const LcdOp &op){
+    if (op.kind == LCD_OP_BACKLIGHT) {
+      if (blDirty) coalesced++;
+      light = op.n != 0;
+      blDirty = true;
+      return;
+    }
+    if (op.row >= ROWS || op.col >= COLS) return;
+
+    uint8_t n = op.n;
+    if (n > LCD_OP_TEXT) n = LCD_OP_TEXT;
+    if (n > COLS - op.col) n = COLS - op.col;
+    if (!n) return;
+
+    memcpy(image[op.row] + op.col, op.text, n);
+    uint32_t m = (n >= 32 ? 0xFFFFFFFFu : (1u << n) - 1) << op.col;
+    coalesced += __builtin_popcount(dirty[op.row] & m);
+    dirty[op.row] |= m;
+  }
+
+  void invalidate(){
+    for (uint8_t r = 0; r < ROWS; r++) dirty[r] = COLS >= 32 ? 0xFFFFFFFFu : (1u << COLS) - 1;
+    blDirty = true;
+  }
+
+  bool pending() const {
+    for (uint8_t r = 0; r < ROWS; r++) if (dirty[r]) return true;
+    return blDirty;
+  }
+
+  // True (once) when the backlight state must be sent
+  bool takeBacklight(bool &on){
+    if (!blDirty) return false;
+    blDirty = false;
+    on = light;
+    return true;
+  }
+
+  // Sends dirty cells; false on the first failed run. `sent` counts
+  // the cells written.
+  template<typename Sink>
+  bool flush(Sink &out, uint16_t &sent){
+    sent = 0;
+    for (uint8_t r = 0; r < ROWS; r++) {
+      uint8_t c = 0;
+      while (c < COLS && (dirty[r] >> c)) {
+        if (!(dirty[r] & (1u << c))) { c++; continue; }
+
+        uint8_t start = c, end = c + 1;
+        for (uint8_t i = end; i < COLS; i++) {
+          if (dirty[r] & (1u << i)) end = i + 1;
+          else if (i - end >= LCD_SHADOW_MERGE_GAP) break;
+        }
+
+        if (!out.run(start, r, image[r] + start, (uint8_t)(end - start))) return false;
+        uint8_t len = end - start;
+        dirty[r] &= ~((len >= 32 ? 0xFFFFFFFFu : (1u << len) - 1) << start);
+        sent += len;
+        c = end;
+      }
+    }
+    return true;
+  }
+
+  uint32_t coalescedCount() const { return coalesced; }
+
+private:
+  char image[ROWS][COLS];
+  uint32_t dirty[ROWS];
+  bool light = true;
+  bool blDirty = true;
+  uint32_t coalesced = 0;   // cells and backlight states overwritten before being sent
+};
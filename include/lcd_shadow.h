@@ -0,0 +1,87 @@
+/**************************************************************
+ * LcdShadow: RAM copy of a character LCD + per-cell diff
+ *
+ *  - renderers write whole lines into the `want` buffer; nothing
+ *    goes to the display until flush()
+ *  - flush() compares `want` with what the display shows and sends
+ *    only changed cells, as runs: one cursor move + the characters
+ *  - two changed runs separated by a single unchanged cell are sent
+ *    as one run (the cell costs the same as the cursor move it saves)
+ *  - invalidate() forgets what the display shows, so the next
+ *    flush() rewrites every cell (replaces a clear(), which blanks
+ *    the screen for ~2 ms and sends the same lines again anyway)
+ *
+ *  Sink: any type with
+ *    void run(uint8_t col, uint8_t row, const char* s, uint8_t n);
+ *
+ *  Single context: the task that renders also flushes.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static const uint8_t LCD_SHADOW_MERGE_GAP = 1;   // unchanged cells bridged inside a run
+
+template<uint8_t COLS, uint8_t ROWS>
+class LcdShadow {
+public:
+  LcdShadow(){
+    memset(want, ' ', sizeof(want));
+    memset(shown, ' ', sizeof(shown));
+  }
+
+  // Line text, truncated / padded with spaces to the display width
+  void setLine(uint8_t row, const char* s, size_t n){
+    if (row >= ROWS) return;
+    if (n > COLS) n = COLS;
+    memcpy(want[row], s, n);
+    memset(want[row] + n, ' ', COLS - n);
+  }
+
+  void invalidate(){ stale = true; }
+
+  // Returns the number of cells sent
+  template<typename Sink>
+  uint16_t flush(Sink &out){
+    uint16_t sent = 0;
+    for (uint8_t r = 0; r < ROWS; r++) {
+      uint8_t c = 0;
+      while (c < COLS) {
+        if (!stale && want[r][c] == shown[r][c]) { c++; continue; }
+
+        // run start; extend over changed cells and short unchanged gaps
+        uint8_t start = c, end = c + 1;
+        for (uint8_t i = end; i < COLS; i++) {
+          if (stale || want[r][i] != shown[r][i]) end = i + 1;
+          else if (i - end >= LCD_SHADOW_MERGE_GAP) break;
+        }
+
+        out.run(start, r, want[r] + start, (uint8_t)(end - start));
+        memcpy(shown[r] + start, want[r] + start, end - start);
+        runs++;
+        sent += end - start;
+        c = end;
+      }
+    }
+    stale = false;
+    flushes++;
+    cells += sent;
+    return sent;
+  }
+
+  const char* line(uint8_t row) const { return want[row]; }   // not terminated
+
+  uint32_t flushCount() const { return flushes; }
+  uint32_t runCount() const { return runs; }
+  uint32_t cellCount() const { return cells; }
+
+private:
+  char want[ROWS][COLS];
+  char shown[ROWS][COLS];
+  bool stale = true;      // display content unknown (boot, invalidate())
+  uint32_t flushes = 0;
+  uint32_t runs = 0;
+  uint32_t cells = 0;
+};
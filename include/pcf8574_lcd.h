@@ -0,0 +1,149 @@
+/**************************************************************
+ * Pcf8574Lcd: HD44780 character LCD behind a PCF8574 I2C backpack
+ *
+ *  The backpack maps P0..P7 to RS, RW, EN, backlight, D4..D7, so a
+ *  byte goes out as two nibbles, each written with EN high and then
+ *  EN low: 4 expander bytes per LCD byte.
+ *
+ *  Generic drivers send every one of those as its own I2C
+ *  transaction. Here a whole run (cursor move + characters) is
+ *  packed into one buffer and sent as a single write of up to
+ *  LCD_TX_MAX bytes. At 400 kHz one expander byte takes ~22 us, so
+ *  each LCD byte spans ~90 us on the wire, more than the 37 us the
+ *  controller needs per write: no delays are needed inside a run.
+ *  Only clear/home (1.52 ms) and the power-on init sequence wait.
+ *
+ *  Write failures (NACK, bus error) are counted; the caller decides
+ *  what to do about them.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Wire.h>
+
+#ifdef I2C_BUFFER_LENGTH
+static const size_t LCD_TX_MAX = I2C_BUFFER_LENGTH;   // Wire's TX buffer
+#else
+static const size_t LCD_TX_MAX = 128;
+#endif
+
+// PCF8574 pin bits
+static const uint8_t LCD_PIN_RS = 0x01;
+static const uint8_t LCD_PIN_EN = 0x04;
+static const uint8_t LCD_PIN_BL = 0x08;
+
+// HD44780 commands
+static const uint8_t LCD_CMD_CLEAR     = 0x01;
+static const uint8_t LCD_CMD_ENTRY     = 0x06;   // increment, no shift
+static const uint8_t LCD_CMD_DISPLAY   = 0x0C;   // display on, no cursor/blink
+static const uint8_t LCD_CMD_FUNCTION  = 0x28;   // 4-bit, 2 lines, 5x8
+static const uint8_t LCD_CMD_DDRAM     = 0x80;
+static const uint32_t LCD_CLEAR_US     = 2000;
+
+class Pcf8574Lcd {
+public:
+  Pcf8574Lcd(TwoWire &bus, uint8_t addr, uint8_t cols, uint8_t rows)
+    : wire(bus), address(addr), ncols(cols), nrows(rows) {}
+
+  // Wire must be started (pins, clock). HD44780 power-on init in
+  // 4-bit mode; true if the expander answered.
+  bool init(){
+    delay(50);                       // Vcc rise to 4.5 V + 40 ms
+    begin();
+    nibble(0x30, 0); send(); delayMicroseconds(4500);
+    nibble(0x30, 0); send(); delayMicroseconds(150);
+    nibble(0x30, 0); send(); delayMicroseconds(150);
+    nibble(0x20, 0); send(); delayMicroseconds(150);   // 4-bit from here
+
+    begin();
+    put(LCD_CMD_FUNCTION, 0);
+    put(LCD_CMD_DISPLAY, 0);
+    put(LCD_CMD_ENTRY, 0);
+    bool ok = send();
+    return clear() && ok;
+  }
+
+  bool clear(){
+    begin();
+    put(LCD_CMD_CLEAR, 0);
+    bool ok = send();
+    delayMicroseconds(LCD_CLEAR_US);
+    return ok;
+  }
+
+  bool backlight(bool on){
+    bl = on ? LCD_PIN_BL : 0;
+    begin();
+    raw(bl);
+    return send();
+  }
+
+  // Cursor move + n characters in as few writes as the TX buffer
+  // allows (one for a 20-column line)
+  bool print(uint8_t col, uint8_t row, const char* s, size_t n){
+    if (row >= nrows || col >= ncols) return false;
+    begin();
+    put(LCD_CMD_DDRAM | (uint8_t)(rowOffset(row) + col), 0);
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) {
+      if (len + 4 > LCD_TX_MAX) ok &= send();   // the next chunk continues at the cursor
+      put((uint8_t)s[i], LCD_PIN_RS);
+    }
+    ok &= send();
+    chars += n;
+    return ok;
+  }
+
+  uint32_t writeCount() const { return writes; }
+  uint32_t byteCount() const { return bytes; }
+  uint32_t charCount() const { return chars; }
+  uint32_t errorCount() const { return errors; }
+
+private:
+  TwoWire &wire;
+  uint8_t address;
+  uint8_t ncols, nrows;
+  uint8_t bl = LCD_PIN_BL;
+
+  uint8_t buf[LCD_TX_MAX];
+  size_t len = 0;
+
+  uint32_t writes = 0;
+  uint32_t bytes = 0;
+  uint32_t chars = 0;
+  uint32_t errors = 0;
+
+  uint8_t rowOffset(uint8_t row) const {
+    static const uint8_t base[4] = { 0x00, 0x40, 0x00, 0x40 };
+    return (uint8_t)(base[row & 3] + (row >= 2 ? ncols : 0));   // rows 2/3 continue rows 0/1
+  }
+
+  void begin(){ len = 0; }
+
+  void raw(uint8_t v){ buf[len++] = v; }
+
+  // High nibble of v, latched on the falling edge of EN
+  void nibble(uint8_t v, uint8_t mode){
+    uint8_t out = (uint8_t)((v & 0xF0) | mode | bl);
+    raw(out | LCD_PIN_EN);
+    raw(out);
+  }
+
+  void put(uint8_t v, uint8_t mode){
+    nibble(v, mode);
+    nibble((uint8_t)(v << 4), mode);
+  }
+
+  bool send(){
+    if (!len) return true;
+    wire.beginTransmission(address);
+    wire.write(buf, len);
+    bool ok = wire.endTransmission() == 0;
+    writes++;
+    bytes += len;
+    if (!ok) errors++;
+    len = 0;
+    return ok;
+  }
+};
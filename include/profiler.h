@@ -0,0 +1,159 @@
+/**************************************************************
+ * Profiler: per-subsystem duration histograms
+ *
+ *  - each slot (scheduler job, task wake, HTTP route) keeps a
+ *    count, a cycle sum, the max in us and log2 buckets in us:
+ *    bucket k counts durations < 2^k us, the last one is overflow
+ *  - durations come from the CPU cycle counter; ProfScope also
+ *    reads the 64-bit us timer and uses it once the 32-bit cycle
+ *    delta could have wrapped (2^32 cycles is ~27 s at 160 MHz)
+ *  - task slots record their busy time per wake, plus the longest
+ *    gap between wakes and how late a wake came after its deadline
+ *
+ *  Slots are registered at boot (add() is not thread-safe). Each
+ *  slot has one writer; readers may see a slot mid-update, which
+ *  is acceptable for metrics.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+static const uint8_t PROF_BUCKETS   = 22;   // < 1 us ... < 2^20 us (~1 s), overflow
+static const uint8_t PROF_MAX_SLOTS = 48;
+static const uint8_t PROF_NAME_LEN  = 32;   // fits "POST /api/settings/sampling"
+
+enum ProfKind : uint8_t { PROF_JOB=0, PROF_TASK=1, PROF_HTTP=2 };
+
+static inline uint32_t profCycles(){
+#ifdef ARDUINO
+  return ESP.getCycleCount();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static inline uint64_t profMicros(){
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time();
+#else
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct ProfSlot {
+  char name[PROF_NAME_LEN];
+  ProfKind kind;
+  uint32_t count;
+  uint64_t sumCycles;
+  uint32_t maxUs;
+  uint32_t bucket[PROF_BUCKETS];
+
+  // PROF_TASK only
+  uint32_t lastWakeUs;
+  uint32_t periodMaxUs;
+  uint32_t lateMaxUs;
+};
+
+class Profiler {
+public:
+  // cyclesPerUs: CPU MHz (1000 on the host, where cycles are ns)
+  void begin(uint32_t cyclesPerUs){
+    cpu = cyclesPerUs ? cyclesPerUs : 1;
+    n = 0;
+  }
+
+  // Returns the slot id, or -1 when full (recording to -1 is a no-op)
+  int8_t add(const char* name, ProfKind kind){
+    if (n >= PROF_MAX_SLOTS) return -1;
+    ProfSlot &s = slots[n];
+    memset(&s, 0, sizeof(s));
+    strncpy(s.name, name, PROF_NAME_LEN - 1);
+    s.kind = kind;
+    return (int8_t)n++;
+  }
+
+  void record(int8_t id, uint64_t cycles){
+    if (id < 0) return;
+    ProfSlot &s = slots[id];
+    s.count++;
+    s.sumCycles += cycles;
+    uint64_t us64 = cycles / cpu;
+    uint32_t us = us64 > UINT32_MAX ? UINT32_MAX : (uint32_t)us64;
+    if (us > s.maxUs) s.maxUs = us;
+    s.bucket[bucketOf(us)]++;
+  }
+
+  // Cycles since (t0, u0): the cycle delta while it cannot have
+  // wrapped, past 2^31 cycles the us timer scaled to cycles
+  uint64_t since(uint32_t t0, uint64_t u0) const {
+    uint32_t c = profCycles() - t0;
+    uint64_t est = (profMicros() - u0) * cpu;
+    return est < (1ull << 31) ? c : est;
+  }
+
+  // Task woke at nowUs for a deadline at dueUs (0 = none, e.g. woken
+  // by a notification). Early wakes count as 0 late.
+  void wake(int8_t id, uint32_t nowUs, uint32_t dueUs){
+    if (id < 0) return;
+    ProfSlot &s = slots[id];
+    if (s.lastWakeUs) {
+      uint32_t gap = nowUs - s.lastWakeUs;
+      if (gap > s.periodMaxUs) s.periodMaxUs = gap;
+    }
+    s.lastWakeUs = nowUs;
+    int32_t late = dueUs ? (int32_t)(nowUs - dueUs) : 0;
+    if (late > 0 && (uint32_t)late > s.lateMaxUs) s.lateMaxUs = (uint32_t)late;
+  }
+
+  static uint8_t bucketOf(uint32_t us){
+    uint8_t b = us ? (uint8_t)(32 - __builtin_clz(us)) : 0;
+    return b < PROF_BUCKETS ? b : PROF_BUCKETS - 1;
+  }
+
+  // Upper bound of bucket b in us (0 for the overflow bucket)
+  static uint32_t bucketLimitUs(uint8_t b){
+    return b + 1 < PROF_BUCKETS ? (1u << b) : 0;
+  }
+
+  // Highest non-empty bucket + 1 (for trimmed output)
+  uint8_t usedBuckets(uint8_t id) const {
+    uint8_t b = PROF_BUCKETS;
+    while (b && slots[id].bucket[b - 1] == 0) b--;
+    return b;
+  }
+
+  float toUs(uint64_t cycles) const { return (float)cycles / (float)cpu; }
+
+  uint8_t count() const { return n; }
+  const ProfSlot& slot(uint8_t id) const { return slots[id]; }
+  uint32_t cyclesPerUs() const { return cpu; }
+
+private:
+  ProfSlot slots[PROF_MAX_SLOTS];
+  uint8_t n = 0;
+  uint32_t cpu = 1;
+};
+
+// Times the enclosing scope into one slot
+class ProfScope {
+public:
+  ProfScope(Profiler &p, int8_t slot) : prof(p), id(slot), t0(profCycles()), u0(profMicros()) {}
+  ~ProfScope(){ prof.record(id, prof.since(t0, u0)); }
+
+private:
+  Profiler &prof;
+  int8_t id;
+  uint32_t t0;
+  uint64_t u0;
+};
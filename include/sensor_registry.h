@@ -0,0 +1,114 @@
+/**************************************************************
+ * SensorList<Ch...>: compile-time sensor channel registry
+ *
+ *  One type list drives the sampling loop, the snapshot layout
+ *  and serialisation. Everything is resolved at compile time
+ *  (recursive templates, static member calls), so there are no
+ *  vtables or function pointers in the sampling path.
+ *
+ *  A channel type provides:
+ *
+ *    struct MyChannel {
+ *      struct State { ... };                 // snapshot layout (trivially copyable)
+ *      static const char* name();            // route /api/<name>, JSON/MQTT key
+ *      static bool sample(State&, const SampleCtx&);   // true if State changed
+ *      static uint32_t intervalMs();         // current sampling interval
+ *      static void toJson(const State&, JsonDocument&);     // /api/<name>
+ *      static void toSummary(const State&, JsonDocument&);  // status payloads
+ *      template<class Sink> static void toMqtt(const State&, Sink&);
+ *    };
+ *
+ *  The registry wraps each State in a ChannelSlot that adds the
+ *  sample timestamp and interval, and chains the slots into
+ *  SensorList<...>::State.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SampleCtx {
+  int64_t t_us;      // esp_timer clock of this sampler run
+  uint32_t now_ms;   // same instant in ms (interval bookkeeping)
+};
+
+struct ChannelMeta {
+  int64_t t_us = 0;          // when State last changed
+  uint32_t interval_ms = 0;  // channel's sampling interval at that time
+  uint32_t samples = 0;      // number of updates
+};
+
+template<typename C>
+struct ChannelSlot {
+  ChannelMeta meta;
+  typename C::State v;
+};
+
+template<typename... Cs> struct SensorList;
+
+template<>
+struct SensorList<> {
+  struct State {};
+  static const size_t count = 0;
+
+  static bool sample(State&, const SampleCtx&){ return false; }
+  template<typename V> static void forEachSlot(const State&, V&){}
+  template<typename V> static void forEachChannel(V&){}
+};
+
+template<typename H, typename... T>
+struct SensorList<H, T...> {
+  typedef SensorList<T...> Tail;
+
+  struct State {
+    ChannelSlot<H> head;
+    typename Tail::State tail;
+  };
+
+  static const size_t count = 1 + Tail::count;
+
+  // Run every channel once; true if any State changed.
+  static bool sample(State &s, const SampleCtx &ctx){
+    bool changed = H::sample(s.head.v, ctx);
+    if (changed) {
+      s.head.meta.t_us = ctx.t_us;
+      s.head.meta.samples++;
+    }
+    s.head.meta.interval_ms = H::intervalMs();
+    return Tail::sample(s.tail, ctx) | changed;
+  }
+
+  // v(const ChannelSlot<C>&) for each channel, in list order
+  template<typename V>
+  static void forEachSlot(const State &s, V &v){
+    v(s.head);
+    Tail::forEachSlot(s.tail, v);
+  }
+
+  // v.template channel<C>() for each channel type (no state needed)
+  template<typename V>
+  static void forEachChannel(V &v){
+    v.template channel<H>();
+    Tail::forEachChannel(v);
+  }
+};
+
+/**************************************************************
+ * SLOT LOOKUP BY CHANNEL TYPE
+ **************************************************************/
+template<typename C, typename L> struct SensorSlotOf;
+
+template<typename C, typename... T>
+struct SensorSlotOf<C, SensorList<C, T...> > {
+  typedef typename SensorList<C, T...>::State State;
+  static ChannelSlot<C>& get(State &s){ return s.head; }
+  static const ChannelSlot<C>& get(const State &s){ return s.head; }
+};
+
+template<typename C, typename H, typename... T>
+struct SensorSlotOf<C, SensorList<H, T...> > {
+  typedef typename SensorList<H, T...>::State State;
+  typedef SensorSlotOf<C, SensorList<T...> > Next;
+  static ChannelSlot<C>& get(State &s){ return Next::get(s.tail); }
+  static const ChannelSlot<C>& get(const State &s){ return Next::get(s.tail); }
+};
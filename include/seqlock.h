@@ -0,0 +1,63 @@
+/**************************************************************
+ * SeqSnapshot<T>: single-writer, many-reader snapshot publisher
+ *
+ *  - two slots + a sequence counter (seqlock)
+ *  - seq odd  : writer is filling slot ((seq/2)+1)&1
+ *    seq even : nothing in flight
+ *    the stable slot is always (seq/2)&1
+ *  - readers copy the stable slot and retry only if the writer
+ *    has since wrapped back onto it (two publishes later), so a
+ *    reader never waits for a write in progress
+ *  - writer never blocks; no mutex on either side
+ *
+ *  Only plain atomic loads/stores are used (no RMW), which the
+ *  ESP32-C3 (RV32IMC, no 'A' extension) does natively.
+ *  T must be trivially copyable.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+template<typename T>
+class SeqSnapshot {
+  static_assert(std::is_trivially_copyable<T>::value, "SeqSnapshot needs a trivially copyable T");
+
+public:
+  // Writer side (one task only)
+  void publish(const T &v){
+    uint32_t s = seq.load(std::memory_order_relaxed);   // even
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(&slot[((s >> 1) + 1) & 1], &v, sizeof(T));
+
+    std::atomic_thread_fence(std::memory_order_release);
+    seq.store(s + 2, std::memory_order_relaxed);
+  }
+
+  // Reader side (any task). Returns the publish count of the copy
+  // (0 = nothing published yet).
+  uint32_t read(T &out) const {
+    for (;;) {
+      uint32_t s1 = seq.load(std::memory_order_acquire);
+      uint32_t base = s1 & ~1u;
+
+      memcpy(&out, &slot[(base >> 1) & 1], sizeof(T));
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint32_t s2 = seq.load(std::memory_order_relaxed);
+      if (s2 - base < 3) return base >> 1;
+    }
+  }
+
+  uint32_t published() const {
+    return seq.load(std::memory_order_acquire) >> 1;
+  }
+
+private:
+  T slot[2] = {};
+  std::atomic<uint32_t> seq{0};
+};
@@ -0,0 +1,202 @@
+/**************************************************************
+ * StallWatchdog: per-subsystem run-time budgets + breadcrumbs
+ *
+ *  - each guarded call is bracketed by enter()/leave() (or a
+ *    StallScope) in the task that runs it; only that task writes
+ *    the slot's run state
+ *  - check() runs in one monitor context and is the only writer of
+ *    the breadcrumb ring:
+ *      "overrun"  a finished call took longer than its budget and
+ *                 longer than any earlier one (new worst case, so a
+ *                 repeat offender does not flush the ring)
+ *      "stall"    a call is still running past max(budget, stallMs),
+ *                 logged once per call
+ *  - StallLog is plain data meant for RTC_NOINIT memory: it keeps
+ *    the crumbs across a panic/watchdog reset, so the next boot can
+ *    tell which subsystem hung
+ *
+ *  Slots are registered at boot (add() is not thread-safe). Readers
+ *  of the ring may see a crumb mid-update, which is acceptable for
+ *  diagnostics.
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+static const uint8_t  STALL_CRUMBS    = 8;
+static const uint8_t  STALL_NAME_LEN  = 16;
+static const uint8_t  STALL_MAX_SLOTS = 24;
+static const uint32_t STALL_LOG_MAGIC = 0x57444731;   // "WDG1"
+
+enum StallKind : uint8_t { STALL_OVERRUN=0, STALL_HUNG=1 };
+
+static inline uint32_t stallNowMs(){
+#ifdef ARDUINO
+  return millis();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct StallCrumb {
+  char name[STALL_NAME_LEN];
+  uint32_t uptimeMs;    // millis() when logged
+  uint32_t elapsedMs;   // run time so far (hung) or total (overrun)
+  uint32_t budgetMs;
+  uint16_t boot;        // StallLog::boots at the time
+  uint8_t kind;         // StallKind
+};
+
+// No constructors or member initialisers: must stay valid as
+// uninitialised RTC memory (checked by begin())
+struct StallLog {
+  uint32_t magic;
+  uint16_t boots;
+  uint8_t head;         // next write
+  uint8_t count;
+  StallCrumb crumb[STALL_CRUMBS];
+
+  // keep=false (power-on) or a corrupt header wipes the ring
+  void begin(bool keep){
+    if (!keep || magic != STALL_LOG_MAGIC || head >= STALL_CRUMBS || count > STALL_CRUMBS) {
+      memset(this, 0, sizeof(*this));
+      magic = STALL_LOG_MAGIC;
+    }
+    for (uint8_t i = 0; i < STALL_CRUMBS; i++) crumb[i].name[STALL_NAME_LEN - 1] = 0;
+    boots++;
+  }
+
+  void push(const StallCrumb &c){
+    crumb[head] = c;
+    head = (uint8_t)((head + 1) % STALL_CRUMBS);
+    if (count < STALL_CRUMBS) count++;
+  }
+
+  // i = 0 is the oldest
+  const StallCrumb& at(uint8_t i) const {
+    return crumb[(head + STALL_CRUMBS - count + i) % STALL_CRUMBS];
+  }
+};
+
+class StallWatchdog {
+public:
+  // stallAfterMs: floor for "still running" reports (slow but
+  // legitimate calls, e.g. a blocking connect, are overruns only)
+  void begin(StallLog &l, uint32_t stallAfterMs){
+    ring = &l;
+    stallMs = stallAfterMs;
+    n = 0;
+  }
+
+  // Returns the slot id, or -1 when full (guarding -1 is a no-op)
+  int8_t add(const char* name, uint32_t budgetMs){
+    if (n >= STALL_MAX_SLOTS) return -1;
+    Slot &s = slots[n];
+    memset(&s, 0, sizeof(s));
+    strncpy(s.name, name, STALL_NAME_LEN - 1);
+    s.budgetMs = budgetMs ? budgetMs : 1;
+    return (int8_t)n++;
+  }
+
+  // Owner task
+  void enter(int8_t id, uint32_t now){
+    if (id < 0) return;
+    slots[id].startMs = now;
+    slots[id].active = true;
+  }
+
+  void leave(int8_t id, uint32_t now){
+    if (id < 0) return;
+    Slot &s = slots[id];
+    s.active = false;
+    uint32_t el = now - s.startMs;
+    if (el > s.budgetMs) {
+      s.overruns++;
+      if (el > s.worstMs) s.worstMs = el;
+    }
+  }
+
+  // Monitor context (one only)
+  void check(uint32_t now){
+    if (!ring) return;
+    for (uint8_t i = 0; i < n; i++) {
+      Slot &s = slots[i];
+
+      if (s.active) {
+        uint32_t start = s.startMs;
+        uint32_t el = now - start;
+        uint32_t limit = s.budgetMs > stallMs ? s.budgetMs : stallMs;
+        if (el > limit && !(s.hungLogged && s.hungStart == start)) {
+          crumb(s, now, el, STALL_HUNG);
+          s.hungStart = start;
+          s.hungLogged = true;
+        }
+      }
+
+      uint32_t worst = s.worstMs;
+      if (worst > s.reportedMs) {
+        crumb(s, now, worst, STALL_OVERRUN);
+        s.reportedMs = worst;
+      }
+    }
+  }
+
+  uint8_t count() const { return n; }
+  const char* name(uint8_t id) const { return slots[id].name; }
+  uint32_t budgetMs(uint8_t id) const { return slots[id].budgetMs; }
+  uint32_t overruns(uint8_t id) const { return slots[id].overruns; }
+  uint32_t worstMs(uint8_t id) const { return slots[id].worstMs; }
+
+private:
+  struct Slot {
+    char name[STALL_NAME_LEN];
+    uint32_t budgetMs;
+
+    // owner task
+    volatile uint32_t startMs;
+    volatile bool active;
+    volatile uint32_t overruns;
+    volatile uint32_t worstMs;
+
+    // monitor
+    uint32_t reportedMs;
+    uint32_t hungStart;
+    bool hungLogged;
+  };
+
+  Slot slots[STALL_MAX_SLOTS];
+  StallLog *ring = nullptr;
+  uint32_t stallMs = 0;
+  uint8_t n = 0;
+
+  void crumb(const Slot &s, uint32_t now, uint32_t elapsed, StallKind kind){
+    StallCrumb c;
+    memcpy(c.name, s.name, STALL_NAME_LEN);
+    c.uptimeMs = now;
+    c.elapsedMs = elapsed;
+    c.budgetMs = s.budgetMs;
+    c.boot = ring->boots;
+    c.kind = kind;
+    ring->push(c);
+  }
+};
+
+// Guards the enclosing scope
+class StallScope {
+public:
+  StallScope(StallWatchdog &w, int8_t slot) : wdt(w), id(slot) { wdt.enter(id, stallNowMs()); }
+  ~StallScope(){ wdt.leave(id, stallNowMs()); }
+
+private:
+  StallWatchdog &wdt;
+  int8_t id;
+};
@@ -0,0 +1,164 @@
+/**************************************************************
+ * TextBuf: fixed-buffer text formatting without heap or printf
+ *
+ *  - appends into a caller-owned char buffer, always terminated;
+ *    text that does not fit is cut off and truncated() is set
+ *  - integers are converted with divide-by-10 loops, fixed-point
+ *    values (v / scale, scale a power of ten) with integer rounding
+ *    to the requested decimals; no float, no soft-float printf
+ *  - width > 0 right-aligns a number in that many columns, like
+ *    printf("%6.1f"); padRight() fills a field on the right
+ *
+ *  FixedText<N> carries its own N-byte buffer (N - 1 characters).
+ **************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class TextBuf {
+public:
+  TextBuf(char* buf, size_t cap) : p(buf), size(cap) { clear(); }
+
+  TextBuf& clear(){
+    len = 0;
+    cut = false;
+    if (size) p[0] = 0;
+    return *this;
+  }
+
+  TextBuf& ch(char c){
+    if (len + 1 < size) {
+      p[len++] = c;
+      p[len] = 0;
+    } else {
+      cut = true;
+    }
+    return *this;
+  }
+
+  TextBuf& str(const char* s){
+    if (!s) return *this;
+    return str(s, strlen(s));
+  }
+
+  TextBuf& str(const char* s, size_t n){
+    size_t room = size ? size - 1 - len : 0;
+    if (n > room) {
+      n = room;
+      cut = true;
+    }
+    memcpy(p + len, s, n);
+    len += n;
+    if (size) p[len] = 0;
+    return *this;
+  }
+
+  TextBuf& u32(uint32_t v, uint8_t width = 0){
+    char d[10];
+    uint8_t n = digits(v, d);
+    pad(width, n);
+    return str(d + sizeof(d) - n, n);
+  }
+
+  TextBuf& i32(int32_t v, uint8_t width = 0){
+    if (v >= 0) return u32((uint32_t)v, width);
+    char d[10];
+    uint32_t m = 0u - (uint32_t)v;
+    uint8_t n = digits(m, d);
+    pad(width, n + 1);
+    ch('-');
+    return str(d + sizeof(d) - n, n);
+  }
+
+  // v / scale with `decimals` digits after the point, rounded half
+  // away from zero. scale: 1, 10, 100, ... (e.g. 1000 for milli).
+  TextBuf& fx(int32_t v, uint32_t scale, uint8_t decimals, uint8_t width = 0){
+    uint32_t unit = pow10(decimals);
+    uint64_t m = v < 0 ? (uint64_t)(0u - (uint32_t)v) : (uint64_t)v;
+    // m / scale in units of 10^-decimals
+    uint64_t q = scale >= unit ? (m + scale / unit / 2) / (scale / unit) : m * (unit / scale);
+
+    char d[20];
+    uint8_t nf = 0, ni;
+    uint64_t ip = q / unit;
+    uint32_t fp = (uint32_t)(q % unit);
+    for (; nf < decimals; nf++) {
+      d[sizeof(d) - 1 - nf] = (char)('0' + fp % 10);
+      fp /= 10;
+    }
+    ni = 0;
+    do {
+      d[sizeof(d) - 1 - nf - 1 - ni] = (char)('0' + ip % 10);
+      ip /= 10;
+      ni++;
+    } while (ip && ni < sizeof(d) - 2 - nf);
+
+    const bool neg = v < 0 && q != 0;
+    const uint8_t n = ni + (decimals ? decimals + 1 : 0) + (neg ? 1 : 0);
+    pad(width, n);
+    if (neg) ch('-');
+    str(d + sizeof(d) - nf - 1 - ni, ni);
+    if (decimals) {
+      ch('.');
+      str(d + sizeof(d) - nf, nf);
+    }
+    return *this;
+  }
+
+  // Dotted quad
+  TextBuf& ip4(uint8_t a, uint8_t b, uint8_t c, uint8_t d){
+    return u32(a).ch('.').u32(b).ch('.').u32(c).ch('.').u32(d);
+  }
+
+  // Spaces up to `width` characters in total
+  TextBuf& padRight(size_t width){
+    while (len < width && !cut) ch(' ');
+    return *this;
+  }
+
+  const char* c_str() const { return p; }
+  size_t length() const { return len; }
+  bool truncated() const { return cut; }
+
+private:
+  char* p;
+  size_t size;
+  size_t len = 0;
+  bool cut = false;
+
+  static uint32_t pow10(uint8_t n){
+    uint32_t r = 1;
+    while (n--) r *= 10;
+    return r;
+  }
+
+  // Right-aligned in d[10]; returns the digit count
+  static uint8_t digits(uint32_t v, char (&d)[10]){
+    uint8_t n = 0;
+    do {
+      d[sizeof(d) - 1 - n++] = (char)('0' + v % 10);
+      v /= 10;
+    } while (v);
+    return n;
+  }
+
+  void pad(uint8_t width, uint8_t n){
+    while (n < width) {
+      ch(' ');
+      n++;
+    }
+  }
+};
+
+template<size_t N>
+class FixedText : public TextBuf {
+public:
+  FixedText() : TextBuf(store, N) {}
+  FixedText(const FixedText&) = delete;
+  FixedText& operator=(const FixedText&) = delete;
+
+private:
+  char store[N];
+};
@@ -17,16 +17,39 @@
 #include <DNSServer.h>
 #include <Preferences.h>
 #include <LittleFS.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_idf_version.h>
 
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 
 #include <ArduinoJson.h>
 #include <PubSubClient.h>
-#include <LiquidCrystal_I2C.h>
+#include <Wire.h>
 
 #include <OneWire.h>
-#include <DallasTemperature.h>
+
+#include "adc_sampler.h"
+#include "adc_filter.h"
+#include "adc_cal_lut.h"
+#include "fixed_point.h"
+#include "seqlock.h"
+#include "ds18_bus.h"
+#include "adaptive_rate.h"
+#include "sensor_registry.h"
+#include "analog_mux.h"
+#include "deadline_sched.h"
+#include "profiler.h"
+#include "stall_watchdog.h"
+#include "event_bus.h"
+#include "button_edges.h"
+#include "boot_trace.h"
+#include "lcd_shadow.h"
+#include "pcf8574_lcd.h"
+#include "lcd_queue.h"
+#include "text_fmt.h"
 
 /**************************************************************
  * VERSION
@@ -40,6 +63,15 @@ static const uint8_t API_VERSION = 1;
 static const char* UI_USER = "admin";
 static const char* UI_PASS = "hydronode";   // change to your own
 
+/**************************************************************
+ * ANALOG MUX (optional)
+ *  Build with -D HYDRO_MUX_INPUTS=8 (or 16) for a 74HC4051/4067 on
+ *  PIN_MUX_ADC. Each input shows up as /api/mux and <base>/mux/<i>.
+ **************************************************************/
+#ifndef HYDRO_MUX_INPUTS
+#define HYDRO_MUX_INPUTS 0
+#endif
+
 /**************************************************************
  * PINS (ESP32-C3 SuperMini)
  **************************************************************/
@@ -51,10 +83,20 @@ static const int PIN_I2C_SCL = 9;
 static const int PIN_EC_ADC    = 0;  // EC analog in
 static const int PIN_LEVEL_ADC = 1;  // Level analog in
 
+#if HYDRO_MUX_INPUTS > 0
+// Mux common needs an ADC1 pin (GPIO0-4), so DOWN moves to GPIO10
+static const int PIN_MUX_ADC = 4;                                 // mux COM
+static const int PIN_MUX_SEL[MUX_SELECT_BITS] = { 6, 7, 20, 21 };  // S0..S3
+#endif
+
 // Buttons (to GND, INPUT_PULLUP)
 static const int PIN_BTN_LIGHT = 2;  // LIGHT/MODE
 static const int PIN_BTN_UP    = 3;  // CAL/UP
+#if HYDRO_MUX_INPUTS > 0
+static const int PIN_BTN_DN    = 10; // DOWN/ENTER
+#else
 static const int PIN_BTN_DN    = 4;  // DOWN/ENTER
+#endif
 
 // DS18B20 (1-Wire)
 static const int PIN_DS18B20   = 5;  // DATA pin
@@ -63,30 +105,105 @@ static const int PIN_DS18B20   = 5;  // DATA pin
 static const uint8_t LCD_ADDR = 0x27;
 static const uint8_t LCD_COLS = 20;
 static const uint8_t LCD_ROWS = 4;
+static const uint32_t LCD_I2C_HZ = 400000;
+static const uint8_t LCD_MAX_HZ_DEFAULT = 5;      // display refresh cap, /api/settings/lcd
+static const uint8_t LCD_MAX_HZ_LIMIT = 20;
 
 /**************************************************************
  * DIVIDER RATIOS
  **************************************************************/
 static const float EC_DIVIDER_RATIO = 2.0f;
 static const float LEVEL_DIVIDER_RATIO = 2.0f;
+static const float MUX_DIVIDER_RATIO = 1.0f;     // mux inputs are 0-3.3V at the pin
 
 /**************************************************************
  * TIMING
  **************************************************************/
-static const uint32_t TICK_UI_MS      = 100;
+static const uint32_t TICK_UI_MS      = 1000;  // LCD backstop; dirty inputs redraw at once
 static const uint32_t TICK_SENSOR_MS  = 250;
-static const uint32_t TICK_MQTT_MS    = 200;
+static const uint32_t SAMPLE_DUE_SLACK_MS = TICK_SENSOR_MS / 2;   // timer jitter, see AdaptiveInterval::due()
+static const uint32_t TICK_MQTT_MS    = 1000;  // keepalive/reconnect; samples pull publishes in
+static const uint32_t MQTT_RETRY_MS   = 15000;
+static const uint32_t TICK_WIFI_MS    = 500;   // STA status refresh
+static const uint32_t STA_CONNECT_MS  = 8000;  // no IP by then -> AP + captive portal
+static const uint32_t TICK_DNS_MS     = 10;    // captive portal DNS (AP mode)
+static const uint32_t TICK_BTN_MS     = 500;   // missed-edge resync; edges wake the UI task
+
+// Tasks: sampling runs in the esp_timer task (sensorTick/muxTick);
+// the rest is split by urgency, each with its own stack budget and
+// a DeadlineScheduler that sleeps until the next TICK_* job is due
+static const UBaseType_t TASK_ACQ_PRIO  = 5;      // DS18B20 1-Wire
+static const UBaseType_t TASK_UI_PRIO   = 3;      // buttons, menus, LCD render
+static const UBaseType_t TASK_LCD_PRIO  = 2;      // LCD I2C writes
+static const UBaseType_t TASK_NET_PRIO  = 1;      // WiFi/DNS, MQTT, NVS writes
+static const uint32_t TASK_ACQ_STACK    = 3072;
+static const uint32_t TASK_UI_STACK     = 4096;
+static const uint32_t TASK_LCD_STACK    = 2560;
+static const uint32_t TASK_NET_STACK    = 6144;
+static const UBaseType_t STORE_QUEUE_LEN = 8;
+static const size_t LCD_QUEUE_LEN = 16;           // runs; a full screen is 4
+static const uint16_t LCD_I2C_TIMEOUT_MS = 20;    // missing ACK / held SCL
+static const uint32_t LCD_RETRY_MS = 2000;        // display down: re-init period
+static const uint32_t LCD_IDLE_MS = 1000;         // writer wake without posts (task WDT)
+static const size_t BUS_RING_LEN = 16;            // events per producer -> consumer ring
+
+// Stall watchdog: run-time budget per job (ms). Overruns and calls
+// still running after WDT_STALL_MS go to an RTC breadcrumb ring; a
+// task that stops waking for WDT_TIMEOUT_S resets the chip (task WDT)
+static const UBaseType_t TASK_WDT_PRIO  = 6;      // monitor, above the work it watches
+static const uint32_t TASK_WDT_STACK    = 2048;
+static const uint32_t WDT_TIMEOUT_S     = 15;     // > blocking connects in the net task
+static const uint32_t WDT_FEED_MS       = 2000;   // longest sleep of a subscribed task
+static const uint32_t WDT_CHECK_MS      = 100;
+static const uint32_t WDT_STALL_MS      = 2000;
+static const uint32_t BUDGET_SAMPLE_MS  = 20;
+static const uint32_t BUDGET_MUX_MS     = 5;
+static const uint32_t BUDGET_TEMP_MS    = 30;     // 1-Wire reset + scratchpad read
+static const uint32_t BUDGET_BTN_MS     = 20;
+static const uint32_t BUDGET_RENDER_MS  = 10;     // render into the shadow + post runs
+static const uint32_t BUDGET_LCD_MS     = 100;    // I2C writes, or bus recovery + re-init
+static const uint32_t BUDGET_WIFI_MS    = 20;
+static const uint32_t BUDGET_MQTT_MS    = 50;     // each of ensure / loop / publish
+static const uint32_t BUDGET_STORE_MS   = 200;    // NVS commit
 
 static const uint32_t SHORT_MS = 60;
 static const uint32_t LONG_MS  = 700;
 static const uint32_t VLONG_MS = 3500;
+static const uint32_t BTN_DEBOUNCE_US   = 15000;
+static const size_t   BTN_EDGE_QUEUE_LEN = 32;    // ISR -> UI task, power of two
 
 static const uint8_t ADC_SAMPLES_PER_TICK = 16;
 
+static const uint32_t DS18_PERIOD_MS = 1000;    // conversion start to start (initial)
+static const uint32_t DS18_RESCAN_MS = 10000;   // bus search while a probe is missing
+
+// Adaptive sampling: per-channel interval bounds (ms), quiet/change
+// bands in the channel's fixed-point unit. TICK_SENSOR_MS is the floor.
+static const uint32_t SAMPLE_MS_LIMIT = 600000;
+
+// Filter chain (median window, EMA shift) per channel, see adc_filter.h
+static const size_t  ADC_FILTER_WINDOW = 9;
+static const uint8_t EC_EMA_SHIFT      = 6;   // ~64 ms @ 1 kHz/channel
+static const uint8_t LEVEL_EMA_SHIFT   = 8;   // ~256 ms, level moves slowly
+static const uint8_t ADC_HAMPEL_K      = 3;
+static const uint8_t ADC_OS_BITS_MAX   = ADC_FILTER_MAX_OS;   // 4^n samples -> +n bits
+
+// Mux scan: 6 of 8 pattern slots -> 6 kHz on the mux pin; per input
+// one in-flight frame + settle is dropped, then MUX_DWELL_SAMPLES are
+// averaged (~5 ms/input, 16 inputs in ~80 ms < TICK_SENSOR_MS)
+static const uint8_t  MUX_ADC_SLOTS     = 6;
+static const uint32_t MUX_SETTLE_US     = 400;
+static const uint16_t MUX_DWELL_SAMPLES = 16;
+static const uint32_t MUX_STEP_US       = 1000;
+
 /**************************************************************
  * OBJECTS
  **************************************************************/
-LiquidCrystal_I2C lcd(LCD_ADDR, LCD_COLS, LCD_ROWS);
+static Pcf8574Lcd lcd(Wire, LCD_ADDR, LCD_COLS, LCD_ROWS);
+static LcdShadow<LCD_COLS, LCD_ROWS> lcdShadow;   // UI task only
+static SpscRing<LcdOp, LCD_QUEUE_LEN> lcdQueue;    // UI task -> LCD writer task
+static LcdPending<LCD_COLS, LCD_ROWS> lcdPending;  // LCD writer task only
+static_assert(LCD_COLS <= LCD_OP_TEXT, "a shadow run must fit one LcdOp");
 AsyncWebServer server(80);
 DNSServer dnsServer;
 Preferences prefs;
@@ -95,7 +212,42 @@ WiFiClient wifiClient;
 PubSubClient mqtt(wifiClient);
 
 OneWire oneWire(PIN_DS18B20);
-DallasTemperature ds18(&oneWire);
+Ds18Bus ds18(oneWire);
+
+// Probe names in ROM order (as enumerated by Ds18Bus::scan())
+static const char* const DS18_PROBE_NAMES[DS18_MAX_PROBES] = { "reservoir", "nutrient", "ambient" };
+
+// Continuous ADC: logical channel order must match adcPins[]
+#if HYDRO_MUX_INPUTS > 0
+enum AdcChan : uint8_t { ADC_CH_EC=0, ADC_CH_LEVEL=1, ADC_CH_MUX=2, ADC_CH_N };
+static const int adcPins[ADC_CH_N]      = { PIN_EC_ADC, PIN_LEVEL_ADC, PIN_MUX_ADC };
+static const uint8_t adcSlots[ADC_CH_N] = { 1, 1, MUX_ADC_SLOTS };
+static const uint32_t ADC_FRAME_BYTES   = (2 + MUX_ADC_SLOTS) * ADC_DMA_RESULT_BYTES;  // one pattern pass
+#else
+enum AdcChan : uint8_t { ADC_CH_EC=0, ADC_CH_LEVEL=1, ADC_CH_N };
+static const int adcPins[ADC_CH_N]      = { PIN_EC_ADC, PIN_LEVEL_ADC };
+static const uint8_t adcSlots[ADC_CH_N] = { 1, 1 };
+static const uint32_t ADC_FRAME_BYTES   = ADC_DMA_FRAME_BYTES;
+#endif
+static AdcSampler<ADC_CH_N> adcSampler;
+// EC and level only; mux inputs are averaged by MuxScanner
+static const uint8_t ADC_FILTERED_N = ADC_CH_LEVEL + 1;
+static AdcFilter<ADC_FILTER_WINDOW> adcFilters[ADC_FILTERED_N] = {
+  AdcFilter<ADC_FILTER_WINDOW>(EC_EMA_SHIFT, ADC_HAMPEL_K),
+  AdcFilter<ADC_FILTER_WINDOW>(LEVEL_EMA_SHIFT, ADC_HAMPEL_K)
+};
+static uint32_t adcCursor[ADC_CH_N] = {};
+
+// eFuse characterisation -> per-channel probe voltage tables
+static AdcCharacterisation adcChar;
+static AdcCalLut ecLut;
+static AdcCalLut lvlLut;
+
+#if HYDRO_MUX_INPUTS > 0
+static GpioMuxSelect muxSelect;
+static MuxScanner<HYDRO_MUX_INPUTS, GpioMuxSelect> muxScan(muxSelect);
+static AdcCalLut muxLut;
+#endif
 
 /**************************************************************
  * STATUS / CONFIG
@@ -104,9 +256,14 @@ struct WifiStatus {
   enum Mode : uint8_t { WIFI_OFF=0, WIFI_AP=1, WIFI_STA=2 } mode = WIFI_OFF;
   bool connected = false;
   String ssid = "";
-  String ip = "";
+  char ip[16] = "";
 };
 
+static const size_t MQTT_TOPIC_LEN   = 96;    // <base_topic>/<sub>, longer ones are skipped
+static const size_t MQTT_PAYLOAD_LEN = 768;   // serialized <base>/status
+static const size_t MQTT_RESET_LEN   = 1024;  // serialized <base>/reset, STALL_CRUMBS full crumbs
+static const size_t MQTT_PACKET_LEN  = MQTT_RESET_LEN + MQTT_TOPIC_LEN + 8;   // PubSubClient buffer, default 256
+
 struct MqttConfig {
   bool enabled = false;
   String host = "";
@@ -121,16 +278,40 @@ struct MqttConfig {
 struct MqttStatus {
   bool configured = false;
   bool connected = false;
-  uint32_t lastAttemptMs = 0;
-  uint32_t lastPublishMs = 0;
+  uint32_t lastAttemptMs = 0;   // 0: never
+  uint32_t lastPublishMs = 0;   // 0: never
+  uint32_t pubSeq = 0;         // snapshot last published (0: none since connect)
   String err = "";
 };
 
+// What the UI task shows of the network side (net task -> UI, mailbox)
+struct NetView {
+  bool sta = false;          // STA mode and connected
+  bool ap = false;           // AP + captive portal (false while STA connects)
+  bool mqtt = false;
+  char ip[16] = "";
+  char topic[32] = "";
+};
+
 enum CalQuality : uint8_t { CAL_NONE=0, CAL_WEAK=1, CAL_OK=2 };
 
+#if HYDRO_MUX_INPUTS > 0
+enum SampleChan : uint8_t { SCH_EC=0, SCH_LEVEL=1, SCH_TEMP=2, SCH_MUX=3, SCH_N };
+static const char* const SAMPLE_CH_NAMES[SCH_N] = { "ec", "level", "temp", "mux" };
+#else
+enum SampleChan : uint8_t { SCH_EC=0, SCH_LEVEL=1, SCH_TEMP=2, SCH_N };
+static const char* const SAMPLE_CH_NAMES[SCH_N] = { "ec", "level", "temp" };
+#endif
+
+// Fixed-point units used from ADC to engineering values
+static const int32_t FX_UV_PER_V    = 1000000;  // voltages in uV
+static const int32_t FX_MILLI       = 1000;     // level value in milli-units
+static const int32_t FX_PCT_SCALE   = 100;      // percent in 1/100 %
+static const int32_t FX_TEMP_SCALE  = 100;      // temperature in 1/100 C
+
 struct EcCalPoint {
-  float ec_us = 1413.0f;
-  float v = 0.0f;
+  int32_t ec_us = 1413;
+  int32_t uv = 0;
   bool set = false;
 };
 
@@ -138,16 +319,15 @@ struct EcCal {
   EcCalPoint A;
   EcCalPoint B;
   bool valid = false;
-  float slope = 1.0f;   // EC = slope * V + offset
-  float offset = 0.0f;
+  LinearQ32 map;        // uS/cm = slope * uV + offset
   CalQuality quality = CAL_NONE;
 };
 
 enum LevelUnit : uint8_t { UNIT_PERCENT=0, UNIT_CUSTOM=1 };
 
 struct LevelCalPoint {
-  float level = 0.0f;
-  float v = 0.0f;
+  int32_t level_m = 0;   // milli-units
+  int32_t uv = 0;
   bool set = false;
 };
 
@@ -155,27 +335,115 @@ struct LevelCal {
   LevelCalPoint empty;
   LevelCalPoint full;
   bool valid = false;
-  float slope = 0.0f;
-  float offset = 0.0f;
+  LinearQ32 map;         // milli-units = slope * uV + offset
   CalQuality quality = CAL_NONE;
   LevelUnit unit = UNIT_PERCENT;
-  float custom_max = 100.0f;
+  int32_t custom_max_m = 100 * FX_MILLI;
+};
+
+// DS18B20 results handed from loop() (1-Wire) to the sampler
+struct TempReadings {
+  uint8_t n = 0;
+  uint8_t bits = DS18_MAX_BITS;   // current DS18B20 resolution (adaptive)
+  int16_t cx100[DS18_MAX_PROBES] = { TEMP_INVALID, TEMP_INVALID, TEMP_INVALID };
+  uint8_t rom[DS18_MAX_PROBES][8] = {};
+  int64_t t_us = 0;               // esp_timer clock when collected
+};
+
+struct EcState {
+  uint8_t adc_bits = ADC_FILTER_IN_BITS;   // resolution of adc_raw (12 + oversample bits)
+  uint16_t adc_raw = 0;
+  int32_t uv = 0;
+  int32_t us = 0;
+};
+
+struct LevelState {
+  uint8_t adc_bits = ADC_FILTER_IN_BITS;
+  uint16_t adc_raw = 0;
+  int32_t uv = 0;
+  int32_t value_m = 0;    // milli-units
+  int32_t pct_x100 = 0;   // 0..10000
+};
+
+// Channel types for SensorRegistry (see sensor_registry.h), defined
+// under SENSORS. A new channel (pH, ORP, second level...) is a State,
+// a channel type and one more entry in the SensorRegistry list.
+struct EcChannel {
+  typedef EcState State;
+  static const SampleChan id = SCH_EC;
+  static const char* name(){ return SAMPLE_CH_NAMES[id]; }
+  static uint32_t intervalMs();
+  static bool sample(State &st, const SampleCtx &ctx);
+  static void toJson(const State &st, JsonDocument &doc);
+  static void toSummary(const State &st, JsonDocument &doc);
+  template<class Sink> static void toMqtt(const State &st, Sink &out);
+};
+
+struct LevelChannel {
+  typedef LevelState State;
+  static const SampleChan id = SCH_LEVEL;
+  static const char* name(){ return SAMPLE_CH_NAMES[id]; }
+  static uint32_t intervalMs();
+  static bool sample(State &st, const SampleCtx &ctx);
+  static void toJson(const State &st, JsonDocument &doc);
+  static void toSummary(const State &st, JsonDocument &doc);
+  template<class Sink> static void toMqtt(const State &st, Sink &out);
+};
+
+// TEMP (probe 0 is the primary reading, TEMP_INVALID if missing)
+struct TempChannel {
+  typedef TempReadings State;
+  static const SampleChan id = SCH_TEMP;
+  static const char* name(){ return SAMPLE_CH_NAMES[id]; }
+  static uint32_t intervalMs();
+  static bool sample(State &st, const SampleCtx &ctx);
+  static void toJson(const State &st, JsonDocument &doc);
+  static void toSummary(const State &st, JsonDocument &doc);
+  template<class Sink> static void toMqtt(const State &st, Sink &out);
+};
+
+#if HYDRO_MUX_INPUTS > 0
+struct MuxState {
+  uint32_t scan = 0;                        // scanner pass these values come from
+  uint16_t adc_raw[HYDRO_MUX_INPUTS] = {};  // 12 bit, dwell average
+  int32_t uv[HYDRO_MUX_INPUTS] = {};        // at the mux pin
+};
+
+struct MuxChannel {
+  typedef MuxState State;
+  static const SampleChan id = SCH_MUX;
+  static const char* name(){ return SAMPLE_CH_NAMES[id]; }
+  static uint32_t intervalMs();
+  static bool sample(State &st, const SampleCtx &ctx);
+  static void toJson(const State &st, JsonDocument &doc);
+  static void toSummary(const State &st, JsonDocument &doc);
+  template<class Sink> static void toMqtt(const State &st, Sink &out);
 };
 
-struct Sensors {
-  // EC
-  uint16_t ec_adc_raw = 0;
-  float ec_v = 0.0f;
-  float ec_us = 0.0f;
+typedef SensorList<EcChannel, LevelChannel, TempChannel, MuxChannel> SensorRegistry;
+#else
+typedef SensorList<EcChannel, LevelChannel, TempChannel> SensorRegistry;
+#endif
+static_assert(SensorRegistry::count == SCH_N, "SampleChan and SensorRegistry out of step");
+
+// Snapshot layout: one ChannelSlot per registered channel
+typedef SensorRegistry::State Sensors;
+
+template<typename C>
+static typename C::State& sensorGet(Sensors &s){
+  return SensorSlotOf<C, SensorRegistry>::get(s).v;
+}
 
-  // LEVEL
-  uint16_t lvl_adc_raw = 0;
-  float lvl_v = 0.0f;
-  float lvl_value = 0.0f;
-  float lvl_percent = 0.0f;
+template<typename C>
+static const ChannelSlot<C>& sensorSlot(const Sensors &s){
+  return SensorSlotOf<C, SensorRegistry>::get(s);
+}
 
-  // TEMP
-  float temp_c = NAN;
+// What consumers (web, MQTT, LCD) see: a consistent copy of Sensors
+struct SensorSnapshot {
+  Sensors s;
+  uint32_t seq = 0;    // increments once per published sample
+  int64_t t_us = 0;    // esp_timer clock when the sample was reduced
 };
 
 static WifiStatus wifiSt;
@@ -183,12 +451,139 @@ static MqttConfig mqttCfg;
 static MqttStatus mqttSt;
 static EcCal ecCal;
 static LevelCal lvlCal;
-static Sensors sens;
+static Sensors sens;                          // sensorTick() working copy
+static SeqSnapshot<SensorSnapshot> sensPub;   // published to readers
+static SeqSnapshot<TempReadings> tempPub;     // loop() 1-Wire -> sampler
+
+// Sampling runs from a periodic esp_timer (esp_timer task), not loop()
+static esp_timer_handle_t sampleTimer = nullptr;
+static portMUX_TYPE calMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Adaptive sampling per channel (bounds are loaded from NVS)
+static AdaptiveInterval sampleRate[SCH_N] = {
+  AdaptiveInterval(TICK_SENSOR_MS, 4000,  5,   50),    // EC: uS/cm
+  AdaptiveInterval(TICK_SENSOR_MS, 10000, 200, 2000),  // level: milli-units
+  AdaptiveInterval(DS18_PERIOD_MS, 30000, 6,   25),    // temp: 1/100 C
+#if HYDRO_MUX_INPUTS > 0
+  AdaptiveInterval(TICK_SENSOR_MS, 10000, 5,   100)    // mux: mV, largest input step
+#endif
+};
+
+// Task plumbing (created in setup())
+enum StoreCmd : uint8_t {
+  STORE_EC_CAL=0, STORE_LEVEL_CAL, STORE_WIFI_WIPE,
+  STORE_ADC_CFG, STORE_SAMPLING, STORE_LCD_CFG, STORE_MQTT_CFG, STORE_WIFI_CREDS,
+  STORE_DS18_SLOTS
+};
+
+struct SampleBounds {
+  uint32_t minMs;
+  uint32_t maxMs;
+};
+
+struct SampleBoundsSet {
+  SampleBounds ch[SCH_N];
+};
+
+// POST /api/settings/sampling -> the tasks that own sampleRate[]:
+// sensorTick() applies EC/level/mux, tempTick() applies temp
+static SeqSnapshot<SampleBoundsSet> sampleStage;
+
+// MQTT settings as plain chars: web -> net task in a StoreMsg, and
+// back as mqttShown. mqttCfg itself is only written by the net task.
+struct MqttFields {
+  bool enabled;
+  char host[64];
+  uint16_t port;
+  char user[33];
+  char pass[65];
+  char topic[MQTT_TOPIC_LEN];
+  bool retain;
+  uint16_t periodMs;
+};
+
+static SeqSnapshot<MqttFields> mqttShown;   // net task -> web handlers
+
+// UI / web -> net task: NVS work, with a copy of what to write. The
+// net task is the only user of `prefs`.
+struct StoreMsg {
+  StoreCmd cmd;
+  EcCal ec;                    // STORE_EC_CAL
+  LevelCal lvl;                // STORE_LEVEL_CAL
+  uint8_t adcOs;               // STORE_ADC_CFG
+  uint8_t lcdHz;               // STORE_LCD_CFG
+  SampleBoundsSet smp;         // STORE_SAMPLING
+  char ssid[33];               // STORE_WIFI_CREDS
+  char pass[65];
+  uint8_t roms[DS18_MAX_PROBES][8];   // STORE_DS18_SLOTS, zero = free slot
+  MqttFields mqtt;             // STORE_MQTT_CFG
+};
+
+static QueueHandle_t storeQueue = nullptr;   // StoreMsg
+static QueueHandle_t netViewBox = nullptr;   // NetView, length 1 (overwrite)
+static TaskHandle_t netTaskHandle = nullptr;  // notified by storePost() and the bus
+static TaskHandle_t uiTaskHandle = nullptr;   // notified by the bus
+static TaskHandle_t lcdTaskHandle = nullptr;  // notified by lcdFlush()
+
+// Event bus: producers are contexts (one SPSC ring per producer and
+// consumer), consumers are the tasks that react to the events
+enum BusKind : uint8_t { BUS_SAMPLE=0, BUS_BUTTON, BUS_WIFI, BUS_CONFIG, BUS_LINK };
+enum BusProducer : uint8_t { BP_SAMPLER=0, BP_UI, BP_NET, BP_WIFI, BP_N };
+enum BusConsumer : uint8_t { BC_UI=0, BC_NET, BC_N };
+enum ConfigId : uint8_t { CFG_ADC=0, CFG_SAMPLING, CFG_MQTT, CFG_CAL, CFG_LCD };
+
+static const char* const BUS_CONSUMER_NAMES[BC_N] = { "ui", "net" };
+
+struct BusEvent {
+  BusKind kind;
+  uint8_t a;     // BUTTON: BtnId, WIFI: STA up, CONFIG: ConfigId, LINK: event id
+  uint8_t b;     // BUTTON: EvType, WIFI: MQTT up
+  uint32_t v;    // SAMPLE: snapshot seq
+};
+
+static EventBus<BusEvent, BP_N, BC_N, BUS_RING_LEN> bus;
+
+// Run-time histograms per job, task, timer and route (/api/metrics)
+static Profiler prof;
+static int8_t profSampleTimer = -1;
+static int8_t profMuxTimer = -1;
+
+// Survives panic / watchdog resets (not power-on), see stall_watchdog.h
+RTC_NOINIT_ATTR static StallLog stallLog;
+static StallWatchdog stallWdt;
+static esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+static int8_t wdtSampleTimer = -1;
+static int8_t wdtMuxTimer = -1;
+
+// Boot timeline: setup() phases + milestones (serial, /api/metrics)
+enum BootMilestone : uint8_t {
+  BOOT_FIRST_SAMPLE=0, BOOT_LCD_READY, BOOT_DS18_READY, BOOT_NET_UP, BOOT_FIRST_PUBLISH, BOOT_FS_MOUNT, BOOT_MS_N
+};
+static const char* const BOOT_MILESTONE_NAMES[BOOT_MS_N] = {
+  "first_sample", "lcd", "ds18", "net_up", "first_publish", "fs_mount"
+};
+static BootTrace boot;
+
+static uint8_t adcOsCfg = 0;               // persisted oversample setting
+static uint8_t adcOsBits = 0;              // active oversample setting (sampler)
+static volatile int8_t adcOsPending = -1;  // set by web handler, applied in sensorTick()
 
 /**************************************************************
  * UI STATE
  **************************************************************/
 static bool lcdBacklight = true;
+static volatile uint8_t lcdMaxHz = LCD_MAX_HZ_DEFAULT;   // web writes, UI reads
+
+// What changed since the last frame (UI task). A screen is rendered
+// only when one of the inputs it shows is dirty (lcdDeps()).
+enum LcdDirty : uint8_t {
+  LCD_DIRTY_SAMPLE    = 1 << 0,   // new sensor snapshot
+  LCD_DIRTY_NET       = 1 << 1,   // WiFi / MQTT status
+  LCD_DIRTY_UI        = 1 << 2,   // screen, menu cursor, wizard step/value, config
+  LCD_DIRTY_BACKLIGHT = 1 << 3,
+  LCD_DIRTY_RENDER    = LCD_DIRTY_SAMPLE | LCD_DIRTY_NET | LCD_DIRTY_UI
+};
+static uint8_t lcdDirty = LCD_DIRTY_RENDER;
 
 static const int MENU_N = 3;
 static const int CAL_N  = 3;
@@ -214,54 +609,139 @@ enum EvType : uint8_t { EV_NONE=0, EV_SHORT=1, EV_LONG=2, EV_VLONG=3 };
 
 struct Btn {
   int pin;
-  bool down;
-  uint32_t downMs;
-  Btn(int p) : pin(p), down(false), downMs(0) {}
+  ButtonTracker trk;   // UI task
+  Btn(int p) : pin(p) {}
 };
 
-static Btn btns[3] = { Btn(PIN_BTN_LIGHT), Btn(PIN_BTN_UP), Btn(PIN_BTN_DN) };
+static const uint8_t BTN_N = 3;
+static Btn btns[BTN_N] = { Btn(PIN_BTN_LIGHT), Btn(PIN_BTN_UP), Btn(PIN_BTN_DN) };
+static SpscRing<ButtonEdge, BTN_EDGE_QUEUE_LEN> btnEdges;   // GPIO ISR -> UI task
 
 /**************************************************************
  * CAL WIZARDS
  **************************************************************/
 enum EcStep : uint8_t { EC_A_SET=0, EC_A_CAP, EC_B_SET, EC_B_CAP, EC_DONE };
 static EcStep ecStep = EC_A_SET;
-static float ecWizardA = 1413.0f;
-static float ecWizardB = 27600.0f;
+static int32_t ecWizardA = 1413;    // uS/cm
+static int32_t ecWizardB = 27600;
 
 enum LvlStep : uint8_t { LVL_UNIT=0, LVL_EMPTY_SET, LVL_EMPTY_CAP, LVL_FULL_SET, LVL_FULL_CAP, LVL_DONE };
 static LvlStep lvlStep = LVL_UNIT;
-static float lvlWizardEmpty = 0.0f;
-static float lvlWizardFull  = 100.0f;
+static int32_t lvlWizardEmpty = 0;                  // milli-units
+static int32_t lvlWizardFull  = 100 * FX_MILLI;
 
 /**************************************************************
  * WIFI / CAPTIVE PORTAL
  **************************************************************/
+// STA first; wifiTick() falls back to AP after STA_CONNECT_MS
+enum WifiPhase : uint8_t { WP_STA_CONNECTING=0, WP_STA, WP_AP };
+
+static volatile WifiPhase wifiPhase = WP_STA_CONNECTING;
+static uint32_t wifiDeadlineMs = 0;
 static bool apMode = false;
 
 /**************************************************************
  * HELPERS
  **************************************************************/
-static String ipToString(const IPAddress& ip){
-  return String(ip[0])+"."+String(ip[1])+"."+String(ip[2])+"."+String(ip[3]);
+static void ipToText(const IPAddress& ip, char* out, size_t n){
+  TextBuf(out, n).ip4(ip[0], ip[1], ip[2], ip[3]);
+}
+
+// Writes the shadow only; lcdFlush() sends what changed
+static void lcdSetLine(uint8_t row, const char* s){
+  lcdShadow.setLine(row, s, strlen(s));
+}
+
+static void lcdSetLine(uint8_t row, const TextBuf& t){
+  lcdShadow.setLine(row, t.c_str(), t.length());
+}
+
+typedef FixedText<LCD_COLS + 1> LcdLine;
+
+// Menu entry with the "> " cursor
+static void lcdSetItem(uint8_t row, bool selected, const char* label){
+  LcdLine l;
+  lcdSetLine(row, l.str(selected ? "> " : "  ").str(label));
+}
+
+// Posts each changed run to the LCD writer task; never touches I2C
+struct LcdQueueSink {
+  bool full = false;
+  void run(uint8_t col, uint8_t row, const char* s, uint8_t n){
+    LcdOp op;
+    op.kind = LCD_OP_RUN;
+    op.row = row;
+    op.col = col;
+    op.n = n;
+    memcpy(op.text, s, n);
+    if (!lcdQueue.push(op)) full = true;
+  }
+};
+
+// A full queue drops runs; the shadow then re-posts the whole
+// screen on the next flush
+static void lcdFlush(){
+  LcdQueueSink sink;
+  uint16_t sent = lcdShadow.flush(sink);
+  if (sink.full) lcdShadow.invalidate();
+  if (sent && lcdTaskHandle) xTaskNotifyGive(lcdTaskHandle);
+}
+
+static bool lcdPostBacklight(bool on){
+  LcdOp op;
+  op.kind = LCD_OP_BACKLIGHT;
+  op.row = op.col = 0;
+  op.n = on ? 1 : 0;
+  if (!lcdQueue.push(op)) return false;
+  if (lcdTaskHandle) xTaskNotifyGive(lcdTaskHandle);
+  return true;
+}
+
+static void busWake(uint8_t consumer){
+  TaskHandle_t h = consumer == BC_UI ? uiTaskHandle : netTaskHandle;
+  if (h) xTaskNotifyGive(h);
+}
+
+// From the context named by `p` only (see BusProducer)
+static void busPost(BusProducer p, BusKind kind, uint8_t a = 0, uint8_t b = 0, uint32_t v = 0){
+  BusEvent e;
+  e.kind = kind;
+  e.a = a;
+  e.b = b;
+  e.v = v;
+  bus.publish(p, e);
 }
 
-static void lcdSetLine(uint8_t row, const String& s){
-  char buf[LCD_COLS + 1];
-  memset(buf, ' ', LCD_COLS);
-  buf[LCD_COLS] = '\0';
+// UI / web -> net task. Waits briefly rather than dropping a setting.
+static bool storeSend(const StoreMsg &m){
+  if (!storeQueue || xQueueSend(storeQueue, &m, pdMS_TO_TICKS(50)) != pdTRUE) {
+    Serial.println("store queue full");
+    return false;
+  }
+  if (netTaskHandle) xTaskNotifyGive(netTaskHandle);
+  return true;
+}
 
-  size_t n = s.length();
-  if (n > LCD_COLS) n = LCD_COLS;
-  memcpy(buf, s.c_str(), n);
+// UI task: calibration and WiFi wipe
+static void storePost(StoreCmd cmd){
+  StoreMsg m;
+  m.cmd = cmd;
+  m.ec = ecCal;
+  m.lvl = lvlCal;
+  storeSend(m);
+}
 
-  lcd.setCursor(0, row);
-  lcd.print(buf);
+static NetView netViewRead(){
+  NetView v;
+  if (netViewBox) xQueuePeek(netViewBox, &v, 0);
+  return v;
 }
 
+// The next flush rewrites every cell, so no clear() is needed
 static void uiSet(UIState st){
   ui = st;
-  lcd.clear();
+  lcdShadow.invalidate();
+  lcdDirty |= LCD_DIRTY_UI;
 }
 
 static void wipeWiFiAndRestart(){
@@ -285,7 +765,7 @@ static bool loadWiFiCreds(String &outSsid, String &outPass){
   return outSsid.length() > 0;
 }
 
-static void saveWiFiCreds(const String &ssid, const String &pass){
+static void saveWiFiCreds(const char* ssid, const char* pass){
   prefs.begin("wifi", false);
   prefs.putString("ssid", ssid);
   prefs.putString("pass", pass);
@@ -294,6 +774,7 @@ static void saveWiFiCreds(const String &ssid, const String &pass){
 
 static void startAP(){
   apMode = true;
+  wifiPhase = WP_AP;
   WiFi.mode(WIFI_AP);
   WiFi.softAP("HydroNode-Setup");
   IPAddress ip = WiFi.softAPIP();
@@ -301,13 +782,15 @@ static void startAP(){
   wifiSt.mode = WifiStatus::WIFI_AP;
   wifiSt.connected = true;
   wifiSt.ssid = "HydroNode-Setup";
-  wifiSt.ip = ipToString(ip);
+  ipToText(ip, wifiSt.ip, sizeof(wifiSt.ip));
 
   dnsServer.start(53, "*", ip);
 }
 
 static void startSTA(){
   apMode = false;
+  wifiPhase = WP_STA_CONNECTING;
+  wifiDeadlineMs = millis() + STA_CONNECT_MS;
   dnsServer.stop();
 
   WiFi.softAPdisconnect(true);
@@ -323,24 +806,49 @@ static void startSTA(){
   }
 }
 
+// Net task; run early by WiFi events (see onWiFiEvent()). Once STA
+// has connected it stays STA (auto-reconnect), AP stays AP.
 static void wifiTick(){
+  if (wifiPhase == WP_STA_CONNECTING){
+    if (WiFi.status() == WL_CONNECTED){
+      wifiPhase = WP_STA;
+      boot.reach(BOOT_NET_UP);
+    }
+    else if ((int32_t)(millis() - wifiDeadlineMs) >= 0) startAP();
+  }
+
   if (!apMode){
+    // WiFi.SSID() allocates: refreshed only when the link changes
     if (WiFi.status() == WL_CONNECTED){
+      char ip[sizeof(wifiSt.ip)];
+      ipToText(WiFi.localIP(), ip, sizeof(ip));
+      if (!wifiSt.connected || strcmp(ip, wifiSt.ip) != 0){
+        memcpy(wifiSt.ip, ip, sizeof(ip));
+        wifiSt.ssid = WiFi.SSID();
+      }
       wifiSt.mode = WifiStatus::WIFI_STA;
       wifiSt.connected = true;
-      wifiSt.ip = ipToString(WiFi.localIP());
-      wifiSt.ssid = WiFi.SSID();
     } else {
+      if (wifiSt.connected){
+        wifiSt.ip[0] = 0;
+        wifiSt.ssid = "";
+      }
       wifiSt.mode = WifiStatus::WIFI_STA;
       wifiSt.connected = false;
-      wifiSt.ip = "";
-      wifiSt.ssid = "";
     }
   } else {
     dnsServer.processNextRequest();
   }
 }
 
+// WiFi event task: only wakes the state machine in the net task
+static void onWiFiEvent(arduino_event_id_t ev, arduino_event_info_t){
+  if (ev == ARDUINO_EVENT_WIFI_STA_GOT_IP || ev == ARDUINO_EVENT_WIFI_STA_LOST_IP ||
+      ev == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    busPost(BP_WIFI, BUS_LINK, (uint8_t)ev);
+  }
+}
+
 /**************************************************************
  * PREFERENCES: MQTT
  **************************************************************/
@@ -357,6 +865,32 @@ static void loadMqtt(){
   prefs.end();
 }
 
+// Net task only (and setup() before it runs)
+static void mqttShow(){
+  MqttFields f;
+  f.enabled = mqttCfg.enabled;
+  strlcpy(f.host, mqttCfg.host.c_str(), sizeof(f.host));
+  f.port = mqttCfg.port;
+  strlcpy(f.user, mqttCfg.user.c_str(), sizeof(f.user));
+  strlcpy(f.pass, mqttCfg.pass.c_str(), sizeof(f.pass));
+  strlcpy(f.topic, mqttCfg.base_topic.c_str(), sizeof(f.topic));
+  f.retain = mqttCfg.retain;
+  f.periodMs = mqttCfg.pub_period_ms;
+  mqttShown.publish(f);
+}
+
+static void mqttApply(const MqttFields &f){
+  mqttCfg.enabled       = f.enabled;
+  mqttCfg.host          = f.host;
+  mqttCfg.port          = f.port;
+  mqttCfg.user          = f.user;
+  mqttCfg.pass          = f.pass;
+  mqttCfg.base_topic    = f.topic;
+  mqttCfg.retain        = f.retain;
+  mqttCfg.pub_period_ms = f.periodMs;
+  mqttShow();
+}
+
 static void saveMqtt(){
   prefs.begin("mqtt", false);
   prefs.putBool("en", mqttCfg.enabled);
@@ -370,107 +904,218 @@ static void saveMqtt(){
   prefs.end();
 }
 
+/**************************************************************
+ * PREFERENCES: ADC
+ **************************************************************/
+static void loadAdcCfg(){
+  prefs.begin("adc", true);
+  adcOsCfg = prefs.getUChar("os", 0);
+  prefs.end();
+  if (adcOsCfg > ADC_OS_BITS_MAX) adcOsCfg = ADC_OS_BITS_MAX;
+}
+
+static void saveAdcCfg(uint8_t os){
+  prefs.begin("adc", false);
+  prefs.putUChar("os", os);
+  prefs.end();
+}
+
+/**************************************************************
+ * PREFERENCES: SAMPLING
+ **************************************************************/
+static void loadSampling(){
+  static const char* const kMin[SCH_N] = {
+    "ec_min", "lvl_min", "t_min",
+#if HYDRO_MUX_INPUTS > 0
+    "mux_min",
+#endif
+  };
+  static const char* const kMax[SCH_N] = {
+    "ec_max", "lvl_max", "t_max",
+#if HYDRO_MUX_INPUTS > 0
+    "mux_max",
+#endif
+  };
+  prefs.begin("sampling", true);
+  for (uint8_t i=0;i<SCH_N;i++){
+    uint32_t lo = prefs.getUInt(kMin[i], sampleRate[i].minMs());
+    uint32_t hi = prefs.getUInt(kMax[i], sampleRate[i].maxMs());
+    sampleRate[i].setBounds(lo, hi);
+  }
+  prefs.end();
+}
+
+static void saveSampling(const SampleBoundsSet &b){
+  static const char* const kMin[SCH_N] = {
+    "ec_min", "lvl_min", "t_min",
+#if HYDRO_MUX_INPUTS > 0
+    "mux_min",
+#endif
+  };
+  static const char* const kMax[SCH_N] = {
+    "ec_max", "lvl_max", "t_max",
+#if HYDRO_MUX_INPUTS > 0
+    "mux_max",
+#endif
+  };
+  prefs.begin("sampling", false);
+  for (uint8_t i=0;i<SCH_N;i++){
+    prefs.putUInt(kMin[i], b.ch[i].minMs);
+    prefs.putUInt(kMax[i], b.ch[i].maxMs);
+  }
+  prefs.end();
+}
+
+/**************************************************************
+ * PREFERENCES: DS18B20 SLOTS
+ **************************************************************/
+// Probe name = slot; the ROM of each slot survives reboots, so a
+// probe missing at boot does not hand its name to another one
+static const char* const DS18_ROM_KEYS[DS18_MAX_PROBES] = { "rom0", "rom1", "rom2" };
+
+static void loadDs18Slots(){
+  prefs.begin("ds18", true);
+  for (uint8_t i=0;i<DS18_MAX_PROBES;i++){
+    uint8_t rom[8];
+    if (prefs.getBytes(DS18_ROM_KEYS[i], rom, sizeof(rom)) == sizeof(rom)) ds18.assign(i, rom);
+  }
+  prefs.end();
+}
+
+static void saveDs18Slots(const uint8_t (&roms)[DS18_MAX_PROBES][8]){
+  prefs.begin("ds18", false);
+  for (uint8_t i=0;i<DS18_MAX_PROBES;i++) prefs.putBytes(DS18_ROM_KEYS[i], roms[i], 8);
+  prefs.end();
+}
+
+/**************************************************************
+ * PREFERENCES: LCD
+ **************************************************************/
+static void loadLcdCfg(){
+  prefs.begin("lcd", true);
+  uint8_t hz = prefs.getUChar("hz", LCD_MAX_HZ_DEFAULT);
+  prefs.end();
+  lcdMaxHz = (hz >= 1 && hz <= LCD_MAX_HZ_LIMIT) ? hz : LCD_MAX_HZ_DEFAULT;
+}
+
+static void saveLcdCfg(uint8_t hz){
+  prefs.begin("lcd", false);
+  prefs.putUChar("hz", hz);
+  prefs.end();
+}
+
 /**************************************************************
  * PREFERENCES: CAL
  **************************************************************/
 static void loadEcCal(){
   prefs.begin("eccal", true);
-  ecCal.A.ec_us = prefs.getFloat("A_ec", 1413.0f);
-  ecCal.A.v     = prefs.getFloat("A_v", 0.0f);
+  ecCal.A.ec_us = fxFromFloat(prefs.getFloat("A_ec", 1413.0f), 1);
+  ecCal.A.uv    = fxFromFloat(prefs.getFloat("A_v", 0.0f), FX_UV_PER_V);
   ecCal.A.set   = prefs.getBool("A_set", false);
 
-  ecCal.B.ec_us = prefs.getFloat("B_ec", 27600.0f);
-  ecCal.B.v     = prefs.getFloat("B_v", 0.0f);
+  ecCal.B.ec_us = fxFromFloat(prefs.getFloat("B_ec", 27600.0f), 1);
+  ecCal.B.uv    = fxFromFloat(prefs.getFloat("B_v", 0.0f), FX_UV_PER_V);
   ecCal.B.set   = prefs.getBool("B_set", false);
   prefs.end();
 }
 
-static void saveEcCal(){
+static void saveEcCal(const EcCal &c){
   prefs.begin("eccal", false);
-  prefs.putFloat("A_ec", ecCal.A.ec_us);
-  prefs.putFloat("A_v",  ecCal.A.v);
-  prefs.putBool("A_set", ecCal.A.set);
+  prefs.putFloat("A_ec", (float)c.A.ec_us);
+  prefs.putFloat("A_v",  fxToFloat(c.A.uv, FX_UV_PER_V));
+  prefs.putBool("A_set", c.A.set);
 
-  prefs.putFloat("B_ec", ecCal.B.ec_us);
-  prefs.putFloat("B_v",  ecCal.B.v);
-  prefs.putBool("B_set", ecCal.B.set);
+  prefs.putFloat("B_ec", (float)c.B.ec_us);
+  prefs.putFloat("B_v",  fxToFloat(c.B.uv, FX_UV_PER_V));
+  prefs.putBool("B_set", c.B.set);
   prefs.end();
 }
 
 static void loadLevelCal(){
   prefs.begin("lvlcal", true);
-  lvlCal.empty.level = prefs.getFloat("E_lvl", 0.0f);
-  lvlCal.empty.v     = prefs.getFloat("E_v",   0.0f);
-  lvlCal.empty.set   = prefs.getBool("E_set",  false);
+  lvlCal.empty.level_m = fxFromFloat(prefs.getFloat("E_lvl", 0.0f), FX_MILLI);
+  lvlCal.empty.uv      = fxFromFloat(prefs.getFloat("E_v",   0.0f), FX_UV_PER_V);
+  lvlCal.empty.set     = prefs.getBool("E_set",  false);
 
-  lvlCal.full.level  = prefs.getFloat("F_lvl", 100.0f);
-  lvlCal.full.v      = prefs.getFloat("F_v",   0.0f);
-  lvlCal.full.set    = prefs.getBool("F_set",  false);
+  lvlCal.full.level_m  = fxFromFloat(prefs.getFloat("F_lvl", 100.0f), FX_MILLI);
+  lvlCal.full.uv       = fxFromFloat(prefs.getFloat("F_v",   0.0f), FX_UV_PER_V);
+  lvlCal.full.set      = prefs.getBool("F_set",  false);
 
-  lvlCal.unit        = (LevelUnit)prefs.getUChar("unit", (uint8_t)UNIT_PERCENT);
-  lvlCal.custom_max  = prefs.getFloat("cmax", 100.0f);
+  lvlCal.unit          = (LevelUnit)prefs.getUChar("unit", (uint8_t)UNIT_PERCENT);
+  lvlCal.custom_max_m  = fxFromFloat(prefs.getFloat("cmax", 100.0f), FX_MILLI);
   prefs.end();
 }
 
-static void saveLevelCal(){
+static void saveLevelCal(const LevelCal &c){
   prefs.begin("lvlcal", false);
-  prefs.putFloat("E_lvl", lvlCal.empty.level);
-  prefs.putFloat("E_v",   lvlCal.empty.v);
-  prefs.putBool("E_set",  lvlCal.empty.set);
+  prefs.putFloat("E_lvl", fxToFloat(c.empty.level_m, FX_MILLI));
+  prefs.putFloat("E_v",   fxToFloat(c.empty.uv, FX_UV_PER_V));
+  prefs.putBool("E_set",  c.empty.set);
 
-  prefs.putFloat("F_lvl", lvlCal.full.level);
-  prefs.putFloat("F_v",   lvlCal.full.v);
-  prefs.putBool("F_set",  lvlCal.full.set);
+  prefs.putFloat("F_lvl", fxToFloat(c.full.level_m, FX_MILLI));
+  prefs.putFloat("F_v",   fxToFloat(c.full.uv, FX_UV_PER_V));
+  prefs.putBool("F_set",  c.full.set);
 
-  prefs.putUChar("unit", (uint8_t)lvlCal.unit);
-  prefs.putFloat("cmax", lvlCal.custom_max);
+  prefs.putUChar("unit", (uint8_t)c.unit);
+  prefs.putFloat("cmax", fxToFloat(c.custom_max_m, FX_MILLI));
   prefs.end();
 }
 
 /**************************************************************
  * CALCULATIONS
  **************************************************************/
+// The sampler (esp_timer task) reads map/valid; commit them together.
+// Single core: the critical section keeps it from running mid-update.
 static void computeEcCal(){
-  ecCal.valid = false;
-  ecCal.quality = CAL_NONE;
-
-  if (!ecCal.A.set || !ecCal.B.set) return;
+  LinearQ32 map = ecCal.map;
+  bool valid = false;
+  CalQuality quality = CAL_NONE;
 
-  float dv = ecCal.B.v - ecCal.A.v;
-  if (fabsf(dv) < 0.02f) {
-    ecCal.quality = CAL_WEAK;
-    return;
+  if (ecCal.A.set && ecCal.B.set) {
+    int32_t dv = ecCal.B.uv - ecCal.A.uv;
+    if (abs(dv) < 20000) {   // 0.02 V
+      quality = CAL_WEAK;
+    } else {
+      map.fit(ecCal.A.uv, ecCal.A.ec_us, ecCal.B.uv, ecCal.B.ec_us);
+      valid = true;
+      quality = CAL_OK;
+    }
   }
 
-  ecCal.slope  = (ecCal.B.ec_us - ecCal.A.ec_us) / dv;
-  ecCal.offset = ecCal.A.ec_us - ecCal.slope * ecCal.A.v;
-
-  ecCal.valid = true;
-  ecCal.quality = CAL_OK;
+  portENTER_CRITICAL(&calMux);
+  ecCal.map = map;
+  ecCal.valid = valid;
+  ecCal.quality = quality;
+  portEXIT_CRITICAL(&calMux);
 }
 
 static void computeLevelCal(){
-  lvlCal.valid = false;
-  lvlCal.quality = CAL_NONE;
-
-  if (!lvlCal.empty.set || !lvlCal.full.set) return;
+  LinearQ32 map = lvlCal.map;
+  bool valid = false;
+  CalQuality quality = CAL_NONE;
 
-  float dv = lvlCal.full.v - lvlCal.empty.v;
-  if (fabsf(dv) < 0.05f) {
-    lvlCal.quality = CAL_WEAK;
-    return;
+  if (lvlCal.empty.set && lvlCal.full.set) {
+    int32_t dv = lvlCal.full.uv - lvlCal.empty.uv;
+    if (abs(dv) < 50000) {   // 0.05 V
+      quality = CAL_WEAK;
+    } else {
+      map.fit(lvlCal.empty.uv, lvlCal.empty.level_m, lvlCal.full.uv, lvlCal.full.level_m);
+      valid = true;
+      quality = CAL_OK;
+    }
   }
 
-  lvlCal.slope  = (lvlCal.full.level - lvlCal.empty.level) / dv;
-  lvlCal.offset = lvlCal.empty.level - (lvlCal.slope * lvlCal.empty.v);
-
-  lvlCal.valid = true;
-  lvlCal.quality = CAL_OK;
+  portENTER_CRITICAL(&calMux);
+  lvlCal.map = map;
+  lvlCal.valid = valid;
+  lvlCal.quality = quality;
+  portEXIT_CRITICAL(&calMux);
 }
 
 /**************************************************************
  * ADC
  **************************************************************/
+// Fallback only: used when the DMA sampler failed to start
 static uint16_t readAdcAvg(int pin){
   uint32_t acc = 0;
   for (uint8_t i=0;i<ADC_SAMPLES_PER_TICK;i++){
@@ -480,124 +1125,535 @@ static uint16_t readAdcAvg(int pin){
   return (uint16_t)(acc / ADC_SAMPLES_PER_TICK);
 }
 
-static float adcToPinVoltage(uint16_t adc){
-  return (adc / 4095.0f) * 3.3f;
+static void applyAdcOversample(uint8_t bits){
+  if (bits > ADC_OS_BITS_MAX) bits = ADC_OS_BITS_MAX;
+  adcOsBits = bits;
+  for (uint8_t i=0;i<ADC_FILTERED_N;i++) adcFilters[i].setOversampleBits(bits);
+  EcState &ec = sensorGet<EcChannel>(sens);
+  LevelState &lvl = sensorGet<LevelChannel>(sens);
+  ec.adc_bits = lvl.adc_bits = ADC_FILTER_IN_BITS + bits;
+  // previous raw values are on the old scale
+  ec.adc_raw = 0;
+  lvl.adc_raw = 0;
+}
+
+// prev: returned while the filter has not captured anything yet
+static uint16_t readAdc(AdcChan ch, uint16_t prev){
+  // no oversampling without the sample stream; keep the scale consistent
+  if (!adcSampler.isRunning()) return (uint16_t)(readAdcAvg(adcPins[ch]) << adcOsBits);
+
+  AdcFilter<ADC_FILTER_WINDOW> &f = adcFilters[ch];
+  adcSampler.consume(ch, adcCursor[ch], [&f](uint16_t raw){ f.push(raw); });
+
+  if (f.ready()) return f.value();
+  return prev;
+}
+
+static void adcBuildLuts(){
+  adcChar.begin();
+  ecLut.build(adcChar, EC_DIVIDER_RATIO);
+  lvlLut.build(adcChar, LEVEL_DIVIDER_RATIO);
+#if HYDRO_MUX_INPUTS > 0
+  muxLut.build(adcChar, MUX_DIVIDER_RATIO);
+#endif
 }
 
-static float ecAdcToProbeVoltage(uint16_t adc){
-  return adcToPinVoltage(adc) * EC_DIVIDER_RATIO;
+static int32_t ecAdcToProbeMicroVolts(uint16_t adc){
+  return (int32_t)ecLut.microVolts(adc, ADC_FILTER_IN_BITS + adcOsBits);
 }
 
-static float levelAdcToProbeVoltage(uint16_t adc){
-  return adcToPinVoltage(adc) * LEVEL_DIVIDER_RATIO;
+static int32_t levelAdcToProbeMicroVolts(uint16_t adc){
+  return (int32_t)lvlLut.microVolts(adc, ADC_FILTER_IN_BITS + adcOsBits);
 }
 
-static float ecVoltageToUs(float v){
-  if (!ecCal.valid) return v * 10000.0f; // fallback
-  return ecCal.slope * v + ecCal.offset;
+static int32_t ecMicroVoltsToUs(int32_t uv){
+  if (!ecCal.valid) return uv / 100; // fallback: 10000 uS per V
+  return ecCal.map.apply(uv);
 }
 
-static float levelVoltageToLevel(float v){
-  if (!lvlCal.valid) return v; // fallback
-  return (lvlCal.slope * v + lvlCal.offset);
+// returns milli-units
+static int32_t levelMicroVoltsToLevel(int32_t uv){
+  if (!lvlCal.valid) return uv / 1000; // fallback: value = volts
+  return lvlCal.map.apply(uv);
 }
 
-static void updateLevelDerived(){
+static void updateLevelDerived(LevelState &st){
+  int32_t pct;
   if (lvlCal.unit == UNIT_PERCENT) {
-    sens.lvl_percent = sens.lvl_value;
+    pct = st.value_m / (FX_MILLI / FX_PCT_SCALE);
   } else {
-    if (lvlCal.custom_max <= 0.0001f) sens.lvl_percent = 0.0f;
-    else sens.lvl_percent = (sens.lvl_value / lvlCal.custom_max) * 100.0f;
+    if (lvlCal.custom_max_m <= 0) pct = 0;
+    else pct = (int32_t)(((int64_t)st.value_m * 100 * FX_PCT_SCALE) / lvlCal.custom_max_m);
   }
-  if (sens.lvl_percent < 0) sens.lvl_percent = 0;
-  if (sens.lvl_percent > 100) sens.lvl_percent = 100;
+  st.pct_x100 = fxClamp(pct, 0, 100 * FX_PCT_SCALE);
 }
 
-static void sensorTick(){
-  sens.ec_adc_raw = readAdcAvg(PIN_EC_ADC);
-  sens.ec_v       = ecAdcToProbeVoltage(sens.ec_adc_raw);
-  sens.ec_us      = ecVoltageToUs(sens.ec_v);
+// Applies staged bounds for the channels this context owns
+static void sampleStageApply(uint32_t &seen, bool temp){
+  if (sampleStage.published() == seen) return;
+  SampleBoundsSet b;
+  seen = sampleStage.read(b);
+  for (uint8_t i=0;i<SCH_N;i++){
+    if ((i == SCH_TEMP) != temp) continue;
+    sampleRate[i].setBounds(b.ch[i].minMs, b.ch[i].maxMs);
+  }
+}
+
+// loop() side: 1-Wire stays out of the sampler, results go through tempPub
+static void tempUpdate(){
+  static TempReadings t;
+  t.n = ds18.count();
+  t.bits = ds18.resolution();
+  t.t_us = esp_timer_get_time();
+  for (uint8_t i=0;i<DS18_MAX_PROBES;i++){
+    if (i < t.n){
+      const Ds18Probe &p = ds18.probe(i);
+      t.cx100[i] = Ds18Bus::rawToCx100(p.raw);
+      memcpy(t.rom[i], p.rom, 8);
+    } else {
+      t.cx100[i] = TEMP_INVALID;
+      memset(t.rom[i], 0, 8);
+    }
+  }
+
+  if (t.cx100[0] != TEMP_INVALID){
+    sampleRate[SCH_TEMP].update((uint32_t)(t.t_us / 1000), t.cx100[0]);
+    ds18.setPeriod(sampleRate[SCH_TEMP].intervalMs());
+  }
+  tempPub.publish(t);
+}
+
+// A slot got a new ROM (first probes, or a replacement): log it and
+// have the net task persist the table; retried while the queue is full
+static void ds18SlotsCheck(){
+  static uint32_t saved = 0, logged = 0;
+  const uint32_t version = ds18.slotVersion();
+  if (version == saved) return;
+
+  StoreMsg m;
+  m.cmd = STORE_DS18_SLOTS;
+  for (uint8_t i=0;i<DS18_MAX_PROBES;i++){
+    const Ds18Probe &p = ds18.probe(i);
+    if (p.assigned) memcpy(m.roms[i], p.rom, 8);
+    else memset(m.roms[i], 0, 8);
+    if (logged == version) continue;
+    Serial.printf("DS18 %s: ", DS18_PROBE_NAMES[i]);
+    if (!p.assigned) Serial.println("-");
+    else {
+      for (uint8_t b=0;b<8;b++) Serial.printf("%02X", p.rom[b]);
+      Serial.println(p.present ? "" : " (missing)");
+    }
+  }
+  logged = version;
+  if (storeSend(m)) saved = version;
+}
+
+// DS18B20 state machine: cheap unless a conversion is due to start/finish
+static void tempTick(){
+  static uint32_t boundsSeen = 0;
+  sampleStageApply(boundsSeen, true);
+  if (ds18.tick(millis())) tempUpdate();
+  ds18SlotsCheck();
+}
+
+static float tempToFloat(int16_t cx100){
+  return (cx100 == TEMP_INVALID) ? NAN : fxToFloat(cx100, FX_TEMP_SCALE);
+}
+
+/**************************************************************
+ * SENSOR CHANNELS
+ *  sample() runs in the sampler (integer only, no bus I/O);
+ *  toJson()/toSummary()/toMqtt() run on snapshot copies.
+ **************************************************************/
+uint32_t EcChannel::intervalMs(){ return sampleRate[id].intervalMs(); }
+
+bool EcChannel::sample(State &st, const SampleCtx &ctx){
+  AdaptiveInterval &rate = sampleRate[id];
+  if (!rate.due(ctx.now_ms, SAMPLE_DUE_SLACK_MS)) return false;
+
+  st.adc_raw = readAdc(ADC_CH_EC, st.adc_raw);
+  st.uv      = ecAdcToProbeMicroVolts(st.adc_raw);
+  st.us      = ecMicroVoltsToUs(st.uv);
+  rate.update(ctx.now_ms, st.us);
+  return true;
+}
+
+void EcChannel::toJson(const State &st, JsonDocument &doc){
+  doc["us_cm"] = st.us;
+  doc["v"] = fxToFloat(st.uv, FX_UV_PER_V);
+  doc["adc_raw"] = st.adc_raw;
+  doc["adc_bits"] = st.adc_bits;
+}
+
+void EcChannel::toSummary(const State &st, JsonDocument &doc){
+  doc["ec_us"] = st.us;
+  doc["ec_v"] = fxToFloat(st.uv, FX_UV_PER_V);
+}
 
-  sens.lvl_adc_raw = readAdcAvg(PIN_LEVEL_ADC);
-  sens.lvl_v       = levelAdcToProbeVoltage(sens.lvl_adc_raw);
+template<class Sink>
+void EcChannel::toMqtt(const State &st, Sink &out){
+  FixedText<12> v;
+  out.publish("/ec", v.i32(st.us).c_str());
+}
+
+uint32_t LevelChannel::intervalMs(){ return sampleRate[id].intervalMs(); }
+
+bool LevelChannel::sample(State &st, const SampleCtx &ctx){
+  AdaptiveInterval &rate = sampleRate[id];
+  if (!rate.due(ctx.now_ms, SAMPLE_DUE_SLACK_MS)) return false;
+
+  st.adc_raw = readAdc(ADC_CH_LEVEL, st.adc_raw);
+  st.uv      = levelAdcToProbeMicroVolts(st.adc_raw);
 
-  float rawLevel   = levelVoltageToLevel(sens.lvl_v);
+  int32_t rawLevel = levelMicroVoltsToLevel(st.uv);
 
   if (lvlCal.unit == UNIT_PERCENT) {
-    if (rawLevel < 0) rawLevel = 0;
-    if (rawLevel > 100) rawLevel = 100;
-    sens.lvl_value = rawLevel;
+    st.value_m = fxClamp(rawLevel, 0, 100 * FX_MILLI);
   } else {
-    if (rawLevel < 0) rawLevel = 0;
-    if (rawLevel > lvlCal.custom_max) rawLevel = lvlCal.custom_max;
-    sens.lvl_value = rawLevel;
+    st.value_m = fxClamp(rawLevel, 0, lvlCal.custom_max_m);
   }
 
-  updateLevelDerived();
+  updateLevelDerived(st);
+  rate.update(ctx.now_ms, st.value_m);
+  return true;
+}
 
-  // DS18B20 non-blocking
-  static uint32_t lastTreq = 0;
-  float t = ds18.getTempCByIndex(0);
-  if (t > -55 && t < 125) sens.temp_c = t;
+void LevelChannel::toJson(const State &st, JsonDocument &doc){
+  doc["percent"] = fxToFloat(st.pct_x100, FX_PCT_SCALE);
+  doc["value"] = fxToFloat(st.value_m, FX_MILLI);
+  doc["v"] = fxToFloat(st.uv, FX_UV_PER_V);
+  doc["adc_raw"] = st.adc_raw;
+  doc["adc_bits"] = st.adc_bits;
+  doc["unit"] = (uint8_t)lvlCal.unit;
+  doc["custom_max"] = fxToFloat(lvlCal.custom_max_m, FX_MILLI);
+}
 
-  uint32_t now = millis();
-  if (now - lastTreq >= 1000) {
-    lastTreq = now;
-    ds18.requestTemperatures();
+void LevelChannel::toSummary(const State &st, JsonDocument &doc){
+  doc["level_percent"] = fxToFloat(st.pct_x100, FX_PCT_SCALE);
+  doc["level_value"] = fxToFloat(st.value_m, FX_MILLI);
+  doc["level_v"] = fxToFloat(st.uv, FX_UV_PER_V);
+}
+
+template<class Sink>
+void LevelChannel::toMqtt(const State &st, Sink &out){
+  FixedText<16> v;
+  out.publish("/level/percent", v.fx(st.pct_x100, FX_PCT_SCALE, 1).c_str());
+  out.publish("/level/value", v.clear().fx(st.value_m, FX_MILLI, 2).c_str());
+}
+
+// Rate is driven by tempUpdate() (loop side); this only picks up tempPub
+uint32_t TempChannel::intervalMs(){ return sampleRate[id].intervalMs(); }
+
+bool TempChannel::sample(State &st, const SampleCtx &){
+  static uint32_t seen = 0;
+  if (tempPub.published() == seen) return false;
+  seen = tempPub.read(st);
+  return true;
+}
+
+void TempChannel::toJson(const State &st, JsonDocument &doc){
+  doc["temp_c"] = tempToFloat(st.cx100[0]);
+  doc["bits"] = st.bits;
+  doc["read_t_us"] = st.t_us;   // when the 1-Wire read finished
+
+  JsonArray probes = doc.createNestedArray("probes");
+  for (uint8_t i=0;i<st.n;i++){
+    char rom[17];
+    for (uint8_t b=0;b<8;b++) snprintf(rom + 2*b, 3, "%02X", st.rom[i][b]);
+
+    JsonObject p = probes.createNestedObject();
+    p["name"] = DS18_PROBE_NAMES[i];
+    p["rom"] = rom;
+    p["ok"] = st.cx100[i] != TEMP_INVALID;
+    p["temp_c"] = tempToFloat(st.cx100[i]);
+  }
+}
+
+void TempChannel::toSummary(const State &st, JsonDocument &doc){
+  doc["temp_c"] = tempToFloat(st.cx100[0]);
+}
+
+template<class Sink>
+void TempChannel::toMqtt(const State &st, Sink &out){
+  // avoid publishing "nan"
+  FixedText<12> v;
+  if (st.cx100[0] != TEMP_INVALID) out.publish("/temp_c", v.fx(st.cx100[0], FX_TEMP_SCALE, 1).c_str());
+  for (uint8_t i=1;i<st.n;i++){
+    if (st.cx100[i] == TEMP_INVALID) continue;
+    FixedText<24> sub;
+    sub.str("/temp/").str(DS18_PROBE_NAMES[i]);
+    out.publish(sub.c_str(), v.clear().fx(st.cx100[i], FX_TEMP_SCALE, 1).c_str());
+  }
+}
+
+#if HYDRO_MUX_INPUTS > 0
+uint32_t MuxChannel::intervalMs(){ return sampleRate[id].intervalMs(); }
+
+// Picks up the newest complete scan (muxTick() runs in the same task)
+bool MuxChannel::sample(State &st, const SampleCtx &ctx){
+  AdaptiveInterval &rate = sampleRate[id];
+  if (!rate.due(ctx.now_ms, SAMPLE_DUE_SLACK_MS) || muxScan.scanCount() == st.scan) return false;
+
+  // largest change of any one input: opposite moves on two inputs
+  // must not cancel, one moving input must not be diluted by the bank
+  int32_t stepMv = 0;
+  for (uint8_t i=0;i<HYDRO_MUX_INPUTS;i++){
+    st.adc_raw[i] = muxScan.value(i);
+    int32_t uv = (int32_t)muxLut.microVolts(st.adc_raw[i], ADC_FILTER_IN_BITS);
+    int32_t d = (uv > st.uv[i] ? uv - st.uv[i] : st.uv[i] - uv) / 1000;
+    if (d > stepMv) stepMv = d;
+    st.uv[i] = uv;
+  }
+  st.scan = muxScan.scanCount();
+  rate.updateStep(ctx.now_ms, stepMv);
+  return true;
+}
+
+void MuxChannel::toJson(const State &st, JsonDocument &doc){
+  doc["inputs"] = HYDRO_MUX_INPUTS;
+  doc["scan"] = st.scan;
+  JsonArray v = doc.createNestedArray("v");
+  JsonArray raw = doc.createNestedArray("adc_raw");
+  for (uint8_t i=0;i<HYDRO_MUX_INPUTS;i++){
+    v.add(fxToFloat(st.uv[i], FX_UV_PER_V));
+    raw.add(st.adc_raw[i]);
+  }
+}
+
+void MuxChannel::toSummary(const State &st, JsonDocument &doc){
+  doc["mux_scan"] = st.scan;
+}
+
+template<class Sink>
+void MuxChannel::toMqtt(const State &st, Sink &out){
+  for (uint8_t i=0;i<HYDRO_MUX_INPUTS;i++){
+    FixedText<8> sub;
+    FixedText<16> v;
+    out.publish(sub.str("/mux/").u32(i).c_str(), v.fx(st.uv[i], FX_UV_PER_V, 3).c_str());
+  }
+}
+#endif
+
+// Registry visitors (forEachSlot / forEachChannel)
+struct SensorSummaryJson {
+  JsonDocument &doc;
+  template<class C> void operator()(const ChannelSlot<C> &slot){ C::toSummary(slot.v, doc); }
+};
+
+struct SensorIntervalJson {
+  JsonObject out;
+  template<class C> void operator()(const ChannelSlot<C> &slot){ out[C::name()] = slot.meta.interval_ms; }
+};
+
+// Runs in the esp_timer task every TICK_SENSOR_MS (or from loop() if
+// the timer could not be created). Only integer work, no bus I/O.
+static void sensorTick(){
+  const int64_t t_us = esp_timer_get_time();
+  const uint32_t now = (uint32_t)(t_us / 1000);
+
+  int8_t os = adcOsPending;
+  if (os >= 0){
+    adcOsPending = -1;
+    applyAdcOversample((uint8_t)os);
+    sampleRate[SCH_EC].kick();
+    sampleRate[SCH_LEVEL].kick();
+  }
+
+  static uint32_t boundsSeen = 0;
+  sampleStageApply(boundsSeen, false);
+
+  // always drain the DMA driver; filtering only runs for due channels
+  adcSampler.poll();
+
+  const SampleCtx ctx = { t_us, now };
+  if (!SensorRegistry::sample(sens, ctx)) return;
+
+  static SensorSnapshot snap;
+  snap.s = sens;
+  snap.seq++;
+  snap.t_us = t_us;
+  sensPub.publish(snap);
+  busPost(BP_SAMPLER, BUS_SAMPLE, 0, 0, snap.seq);
+  boot.reach(BOOT_FIRST_SAMPLE);
+}
+
+// esp_timer callbacks: lateness against the periodic alarm schedule
+static void profTimerWake(int8_t slot, uint32_t &dueUs, uint32_t periodUs){
+  const uint32_t t = (uint32_t)esp_timer_get_time();
+  prof.wake(slot, t, dueUs);
+  dueUs = (dueUs ? dueUs : t) + periodUs;
+}
+
+static void onSampleTimer(void*){
+  static uint32_t dueUs = 0;
+  profTimerWake(profSampleTimer, dueUs, TICK_SENSOR_MS * 1000);
+  StallScope guard(stallWdt, wdtSampleTimer);
+  ProfScope busy(prof, profSampleTimer);
+  sensorTick();
+}
+
+// Periodic callback in the esp_timer task (all such callbacks are
+// serialised there, so they share sampler state without locks)
+static bool timerStart(esp_timer_handle_t &h, esp_timer_cb_t cb, const char* name, uint64_t periodUs){
+  esp_timer_create_args_t args = {};
+  args.callback = cb;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = name;
+
+  if (esp_timer_create(&args, &h) != ESP_OK) {
+    h = nullptr;
+    return false;
+  }
+  if (esp_timer_start_periodic(h, periodUs) != ESP_OK) {
+    esp_timer_delete(h);
+    h = nullptr;
+    return false;
+  }
+  return true;
+}
+
+static bool sampleTimerStart(){
+  if (!timerStart(sampleTimer, &onSampleTimer, "sample", (uint64_t)TICK_SENSOR_MS * 1000ULL)) return false;
+  profSampleTimer = prof.add("timer.sample", PROF_TASK);
+  wdtSampleTimer = stallWdt.add("timer.sample", BUDGET_SAMPLE_MS);
+  return true;
+}
+
+#if HYDRO_MUX_INPUTS > 0
+static esp_timer_handle_t muxTimer = nullptr;
+
+// Drain the DMA and advance the mux scan. Needs the sample stream;
+// with the analogRead() fallback the mux inputs are not scanned.
+static void muxTick(){
+  if (!adcSampler.isRunning()) return;
+  adcSampler.poll();
+  muxScan.step(adcSampler, ADC_CH_MUX);
+}
+
+static void onMuxTimer(void*){
+  static uint32_t dueUs = 0;
+  profTimerWake(profMuxTimer, dueUs, MUX_STEP_US);
+  StallScope guard(stallWdt, wdtMuxTimer);
+  ProfScope busy(prof, profMuxTimer);
+  muxTick();
+}
+
+static void muxBegin(){
+  muxSelect.begin(PIN_MUX_SEL);
+  uint16_t discard = muxDiscardSamples(adcSampler.inFlight(ADC_CH_MUX),
+                                       adcSampler.channelHz(ADC_CH_MUX), MUX_SETTLE_US);
+  muxScan.begin(discard, MUX_DWELL_SAMPLES);
+
+  // same task as sensorTick(), or both from loop()
+  if (sampleTimer && timerStart(muxTimer, &onMuxTimer, "mux", MUX_STEP_US)) {
+    profMuxTimer = prof.add("timer.mux", PROF_TASK);
+    wdtMuxTimer = stallWdt.add("timer.mux", BUDGET_MUX_MS);
   }
 }
+#endif
+
+// Lock-free consistent copy for any task (AsyncTCP, loop)
+static SensorSnapshot sensorsRead(){
+  SensorSnapshot snap;
+  sensPub.read(snap);
+  return snap;
+}
 
 /**************************************************************
  * BUTTON EVENTS
  **************************************************************/
-static EvType pollButton(BtnId id){
-  Btn &b = btns[(int)id];
-  bool pressed = (digitalRead(b.pin) == LOW);
+// GPIO ISR (all pins share one handler, so the ring has a single
+// producer): stamp the edge with the level it left, wake the UI task
+static void IRAM_ATTR btnEdgeIsr(BtnId id){
+  ButtonEdge e;
+  e.t_us = (uint32_t)esp_timer_get_time();
+  e.btn = id;
+  e.pressed = digitalRead(btns[id].pin) == LOW;
+  btnEdges.push(e);
+
+  BaseType_t woken = pdFALSE;
+  if (uiTaskHandle) vTaskNotifyGiveFromISR(uiTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
 
-  if (pressed && !b.down){
-    b.down = true;
-    b.downMs = millis();
-    return EV_NONE;
+static void IRAM_ATTR onBtnLight(){ btnEdgeIsr(BTN_LIGHT); }
+static void IRAM_ATTR onBtnUp(){ btnEdgeIsr(BTN_UP); }
+static void IRAM_ATTR onBtnDn(){ btnEdgeIsr(BTN_DN); }
+
+static void buttonsBegin(){
+  static void (*const isr[BTN_N])() = { onBtnLight, onBtnUp, onBtnDn };
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  for (uint8_t i=0;i<BTN_N;i++){
+    pinMode(btns[i].pin, INPUT_PULLUP);
+    btns[i].trk.begin(BTN_DEBOUNCE_US, digitalRead(btns[i].pin) == LOW, now);
+    attachInterrupt(digitalPinToInterrupt(btns[i].pin), isr[i], CHANGE);
   }
+}
 
-  if (!pressed && b.down){
-    uint32_t dur = millis() - b.downMs;
-    b.down = false;
-
-    if (dur >= VLONG_MS) return EV_VLONG;
-    if (dur >= LONG_MS)  return EV_LONG;
-    if (dur >= SHORT_MS) return EV_SHORT;
-  }
+static EvType classifyPress(uint32_t heldUs){
+  const uint32_t ms = heldUs / 1000;
+  if (ms >= VLONG_MS) return EV_VLONG;
+  if (ms >= LONG_MS)  return EV_LONG;
+  if (ms >= SHORT_MS) return EV_SHORT;
   return EV_NONE;
 }
 
 /**************************************************************
  * LCD RENDER
  **************************************************************/
-static void renderHome(){
-  String w = (wifiSt.mode==WifiStatus::WIFI_STA && wifiSt.connected) ? "STA" : "AP ";
-  String m = mqttSt.connected ? "M" : " ";
-  lcdSetLine(0, "HydroNode " + w + " " + m);
+// Formatted text of one display field, redone only when the value
+// it shows changes (fixed-point input as the key)
+struct LcdField {
+  int32_t key = INT32_MIN;
+  char text[12];
+
+  bool stale(int32_t k){
+    if (key == k) return false;
+    key = k;
+    return true;
+  }
+};
 
-  float ec_ms = sens.ec_us / 1000.0f;
+static LcdField homeEc, homeTemp, homeWater;
 
-  char l1[32];
-  if (isnan(sens.temp_c)) snprintf(l1, sizeof(l1), "EC:%4.2fmS  T:--.-C", ec_ms);
-  else                   snprintf(l1, sizeof(l1), "EC:%4.2fmS  T:%4.1fC", ec_ms, sens.temp_c);
-  lcdSetLine(1, String(l1));
+// Sample fields re-render on LCD_DIRTY_SAMPLE, the status lines on
+// LCD_DIRTY_NET; both only when the screen is due (lcdTick)
+static void renderHome(){
+  const NetView nv = netViewRead();
+  LcdLine l;
+  if (lcdDirty & (LCD_DIRTY_NET | LCD_DIRTY_UI)){
+    l.str("HydroNode ").str(nv.sta ? "STA" : (nv.ap ? "AP " : "...")).ch(' ').ch(nv.mqtt ? 'M' : ' ');
+    lcdSetLine(0, l);
+
+    if (nv.sta) lcdSetLine(3, l.clear().str("IP: ").str(nv.ip));
+    else if (nv.ap) lcdSetLine(3, "AP: 192.168.4.1");
+    else lcdSetLine(3, "WiFi: connecting");
+  }
 
-  char l2[32]; snprintf(l2, sizeof(l2), "Water: %6.1f %%", sens.lvl_percent);
-  lcdSetLine(2, String(l2));
+  if (lcdDirty & (LCD_DIRTY_SAMPLE | LCD_DIRTY_UI)){
+    const Sensors s = sensorsRead().s;
+    const int32_t ecUs = sensorSlot<EcChannel>(s).v.us;
+    const int16_t tc = sensorSlot<TempChannel>(s).v.cx100[0];
+    const int32_t pct = sensorSlot<LevelChannel>(s).v.pct_x100;
+
+    if (homeEc.stale(ecUs)) TextBuf(homeEc.text, sizeof(homeEc.text)).fx(ecUs, 1000, 2, 4);   // mS
+    if (homeTemp.stale(tc)){
+      TextBuf t(homeTemp.text, sizeof(homeTemp.text));
+      if (tc == TEMP_INVALID) t.str("--.-");
+      else t.fx(tc, FX_TEMP_SCALE, 1, 4);
+    }
+    if (homeWater.stale(pct)) TextBuf(homeWater.text, sizeof(homeWater.text)).fx(pct, FX_PCT_SCALE, 1, 6);
 
-  if (wifiSt.mode==WifiStatus::WIFI_STA && wifiSt.connected) lcdSetLine(3, "IP: " + wifiSt.ip);
-  else lcdSetLine(3, "AP: 192.168.4.1");
+    lcdSetLine(1, l.clear().str("EC:").str(homeEc.text).str("mS  T:").str(homeTemp.text).ch('C'));
+    lcdSetLine(2, l.clear().str("Water: ").str(homeWater.text).str(" %"));
+  }
 }
 
 static void renderMenu(){
   lcdSetLine(0, "Menu");
-  lcdSetLine(1, (menuIndex==0?"> ":"  ") + String("Setup"));
-  lcdSetLine(2, (menuIndex==1?"> ":"  ") + String("Calibration"));
-  lcdSetLine(3, (menuIndex==2?"> ":"  ") + String("Info / Exit"));
+  lcdSetItem(1, menuIndex==0, "Setup");
+  lcdSetItem(2, menuIndex==1, "Calibration");
+  lcdSetItem(3, menuIndex==2, "Info / Exit");
 }
 
 static void renderSetup(){
@@ -608,24 +1664,27 @@ static void renderSetup(){
 }
 
 static void renderInfo(){
-  lcdSetLine(0, String("FW: ")+FW_VERSION);
-  lcdSetLine(1, String("MQTT: ")+(mqttSt.connected?"OK":"OFF"));
-  lcdSetLine(2, String("Topic: ")+mqttCfg.base_topic);
+  const NetView nv = netViewRead();
+  LcdLine l;
+  lcdSetLine(0, l.str("FW: ").str(FW_VERSION));
+  lcdSetLine(1, l.clear().str("MQTT: ").str(nv.mqtt ? "OK" : "OFF"));
+  lcdSetLine(2, l.clear().str("Topic: ").str(nv.topic));
   lcdSetLine(3, "Back");
 }
 
 static void renderCalMenu(){
   lcdSetLine(0, "Calibration");
-  lcdSetLine(1, (calIndex==0?"> ":"  ") + String("EC Wizard"));
-  lcdSetLine(2, (calIndex==1?"> ":"  ") + String("Level Wizard"));
-  lcdSetLine(3, (calIndex==2?"> ":"  ") + String("Back"));
+  lcdSetItem(1, calIndex==0, "EC Wizard");
+  lcdSetItem(2, calIndex==1, "Level Wizard");
+  lcdSetItem(3, calIndex==2, "Back");
 }
 
 static void renderEcWizard(){
+  LcdLine l;
   lcdSetLine(0, "EC Wizard (V->EC)");
   if (ecStep == EC_A_SET){
     lcdSetLine(1, "Set A solution:");
-    lcdSetLine(2, "A=" + String(ecWizardA,0) + " uS");
+    lcdSetLine(2, l.str("A=").i32(ecWizardA).str(" uS"));
     lcdSetLine(3, "UP/DN adj,ENT next");
   } else if (ecStep == EC_A_CAP){
     lcdSetLine(1, "In A solution now");
@@ -633,7 +1692,7 @@ static void renderEcWizard(){
     lcdSetLine(3, "Back");
   } else if (ecStep == EC_B_SET){
     lcdSetLine(1, "Set B solution:");
-    lcdSetLine(2, "B=" + String(ecWizardB,0) + " uS");
+    lcdSetLine(2, l.str("B=").i32(ecWizardB).str(" uS"));
     lcdSetLine(3, "UP/DN adj,ENT next");
   } else if (ecStep == EC_B_CAP){
     lcdSetLine(1, "In B solution now");
@@ -647,15 +1706,16 @@ static void renderEcWizard(){
 }
 
 static void renderLevelUnit(){
+  LcdLine l;
   lcdSetLine(0, "Level Unit");
-  String u = (lvlCal.unit==UNIT_PERCENT) ? "%" : "CUSTOM";
-  lcdSetLine(1, "Unit: " + u);
-  if (lvlCal.unit==UNIT_CUSTOM) lcdSetLine(2, "Max: " + String(lvlCal.custom_max,1));
+  lcdSetLine(1, l.str("Unit: ").str(lvlCal.unit==UNIT_PERCENT ? "%" : "CUSTOM"));
+  if (lvlCal.unit==UNIT_CUSTOM) lcdSetLine(2, l.clear().str("Max: ").fx(lvlCal.custom_max_m, FX_MILLI, 1));
   else lcdSetLine(2, " ");
   lcdSetLine(3, "UP toggle,ENT ok");
 }
 
 static void renderLevelWizard(){
+  LcdLine l;
   lcdSetLine(0, "Level Wizard");
   if (lvlStep == LVL_UNIT){
     lcdSetLine(1, "Select unit first");
@@ -663,7 +1723,7 @@ static void renderLevelWizard(){
     lcdSetLine(3, "Back");
   } else if (lvlStep == LVL_EMPTY_SET){
     lcdSetLine(1, "Empty value:");
-    lcdSetLine(2, String(lvlWizardEmpty,1));
+    lcdSetLine(2, l.fx(lvlWizardEmpty, FX_MILLI, 1));
     lcdSetLine(3, "UP/DN adj,ENT next");
   } else if (lvlStep == LVL_EMPTY_CAP){
     lcdSetLine(1, "Set EMPTY state");
@@ -671,7 +1731,7 @@ static void renderLevelWizard(){
     lcdSetLine(3, "Back");
   } else if (lvlStep == LVL_FULL_SET){
     lcdSetLine(1, "Full value:");
-    lcdSetLine(2, String(lvlWizardFull,1));
+    lcdSetLine(2, l.fx(lvlWizardFull, FX_MILLI, 1));
     lcdSetLine(3, "UP/DN adj,ENT next");
   } else if (lvlStep == LVL_FULL_CAP){
     lcdSetLine(1, "Set FULL state");
@@ -684,13 +1744,42 @@ static void renderLevelWizard(){
   }
 }
 
-static void lcdTick(){
-  if (lcdBacklight) lcd.backlight();
-  else lcd.noBacklight();
-
-  switch(ui){
-    case UI_HOME:       renderHome(); break;
-    case UI_MENU:       renderMenu(); break;
+static void lcdSplash(){
+  lcdSetLine(0, "HydroNode");
+  lcdSetLine(1, "EC + Water Level");
+  lcdSetLine(2, "Booting...");
+  lcdSetLine(3, "");
+  lcdFlush();
+}
+
+// Inputs each screen shows besides its own UI state
+static uint8_t lcdDeps(UIState st){
+  switch(st){
+    case UI_HOME: return LCD_DIRTY_UI | LCD_DIRTY_SAMPLE | LCD_DIRTY_NET;
+    case UI_INFO: return LCD_DIRTY_UI | LCD_DIRTY_NET;
+    default:      return LCD_DIRTY_UI;
+  }
+}
+
+static uint32_t lcdFrameMs = 0;     // last render
+static uint32_t lcdFrames = 0;
+static uint32_t lcdIdleTicks = 0;   // ran, nothing to draw
+
+static void lcdTick(){
+  // a full writer queue leaves the flag set; the backstop tick retries
+  if ((lcdDirty & LCD_DIRTY_BACKLIGHT) && lcdPostBacklight(lcdBacklight)) lcdDirty &= ~LCD_DIRTY_BACKLIGHT;
+
+  if (!(lcdDirty & lcdDeps(ui))){
+    lcdDirty &= ~LCD_DIRTY_RENDER;
+    lcdIdleTicks++;
+    return;
+  }
+  lcdFrameMs = millis();
+  lcdFrames++;
+
+  switch(ui){
+    case UI_HOME:       renderHome(); break;
+    case UI_MENU:       renderMenu(); break;
     case UI_SETUP:      renderSetup(); break;
     case UI_INFO:       renderInfo(); break;
     case UI_CAL_MENU:   renderCalMenu(); break;
@@ -699,6 +1788,80 @@ static void lcdTick(){
     case UI_CAL_LEVEL:  renderLevelWizard(); break;
     default:            renderHome(); break;
   }
+  lcdDirty &= ~LCD_DIRTY_RENDER;
+  lcdFlush();
+}
+
+/**************************************************************
+ * LCD WRITER (LCD task: the only I2C user)
+ **************************************************************/
+static bool lcdUp = false;
+static uint32_t lcdRecoveries = 0;
+static uint32_t lcdFullRefreshUs = 0;   // latest full 20x4 write
+
+// A slave cut off mid-byte can hold SDA low: clock SCL until it
+// lets go, then send a STOP
+static void i2cBusClear(){
+  pinMode(PIN_I2C_SDA, INPUT_PULLUP);
+  pinMode(PIN_I2C_SCL, OUTPUT_OPEN_DRAIN);
+  digitalWrite(PIN_I2C_SCL, HIGH);
+  for (uint8_t i=0;i<9 && digitalRead(PIN_I2C_SDA)==LOW;i++){
+    digitalWrite(PIN_I2C_SCL, LOW);  delayMicroseconds(5);
+    digitalWrite(PIN_I2C_SCL, HIGH); delayMicroseconds(5);
+  }
+  digitalWrite(PIN_I2C_SCL, LOW);  delayMicroseconds(5);
+  pinMode(PIN_I2C_SDA, OUTPUT_OPEN_DRAIN);
+  digitalWrite(PIN_I2C_SDA, LOW);  delayMicroseconds(5);
+  digitalWrite(PIN_I2C_SCL, HIGH); delayMicroseconds(5);
+  digitalWrite(PIN_I2C_SDA, HIGH); delayMicroseconds(5);
+}
+
+// Starts Wire and the display; every later call is a recovery (bus
+// cleared first). The controller may have lost its nibble phase, so
+// it is re-initialised and the whole frame is sent again.
+static bool lcdStart(){
+  static bool started = false;
+  if (started){
+    lcdRecoveries++;
+    Wire.end();
+    i2cBusClear();
+  }
+  started = true;
+  Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL, LCD_I2C_HZ);
+  Wire.setTimeOut(LCD_I2C_TIMEOUT_MS);
+  lcdUp = lcd.init();
+  lcdPending.invalidate();
+  return lcdUp;
+}
+
+// One I2C write per run
+struct LcdI2cSink {
+  bool run(uint8_t col, uint8_t row, const char* s, uint8_t n){
+    return lcd.print(col, row, s, n);
+  }
+};
+
+// Queued ops go into the frame first, so text superseded while the
+// display was busy (or down) is never sent
+static void lcdWrite(){
+  LcdOp op;
+  while (lcdQueue.pop(op)) lcdPending.apply(op);
+  if (!lcdUp) return;
+
+  bool ok = true;
+  bool on;
+  if (lcdPending.takeBacklight(on)) ok = lcd.backlight(on);
+
+  LcdI2cSink sink;
+  uint16_t sent = 0;
+  uint32_t t0 = micros();
+  if (ok) ok = lcdPending.flush(sink, sent);
+  if (ok && sent == LCD_COLS * LCD_ROWS) lcdFullRefreshUs = micros() - t0;
+
+  if (!ok){
+    Serial.println("LCD write failed, recovering I2C");
+    lcdStart();
+  }
 }
 
 /**************************************************************
@@ -714,8 +1877,9 @@ static void handleEvent(BtnId b, EvType ev){
       else uiSet(UI_MENU);
     } else if (ev == EV_LONG){
       lcdBacklight = !lcdBacklight;
+      lcdDirty |= LCD_DIRTY_BACKLIGHT;
     } else if (ev == EV_VLONG){
-      wipeWiFiAndRestart();
+      storePost(STORE_WIFI_WIPE);
     }
     return;
   }
@@ -728,13 +1892,13 @@ static void handleEvent(BtnId b, EvType ev){
     } else if (ui == UI_CAL_MENU){
       calIndex = (calIndex + CAL_N - 1) % CAL_N;
     } else if (ui == UI_CAL_EC){
-      if (ecStep == EC_A_SET) ecWizardA += 10.0f;
-      else if (ecStep == EC_B_SET) ecWizardB += 100.0f;
+      if (ecStep == EC_A_SET) ecWizardA += 10;
+      else if (ecStep == EC_B_SET) ecWizardB += 100;
     } else if (ui == UI_LEVEL_UNIT){
       lvlCal.unit = (lvlCal.unit == UNIT_PERCENT) ? UNIT_CUSTOM : UNIT_PERCENT;
     } else if (ui == UI_CAL_LEVEL){
-      if (lvlStep == LVL_EMPTY_SET) lvlWizardEmpty += 1.0f;
-      else if (lvlStep == LVL_FULL_SET) lvlWizardFull += 1.0f;
+      if (lvlStep == LVL_EMPTY_SET) lvlWizardEmpty += FX_MILLI;
+      else if (lvlStep == LVL_FULL_SET) lvlWizardFull += FX_MILLI;
     }
     return;
   }
@@ -763,8 +1927,8 @@ static void handleEvent(BtnId b, EvType ev){
           uiSet(UI_CAL_EC);
         } else if (calIndex == 1){
           lvlStep = LVL_UNIT;
-          lvlWizardEmpty = 0.0f;
-          lvlWizardFull  = (lvlCal.unit==UNIT_PERCENT) ? 100.0f : lvlCal.custom_max;
+          lvlWizardEmpty = 0;
+          lvlWizardFull  = (lvlCal.unit==UNIT_PERCENT) ? 100 * FX_MILLI : lvlCal.custom_max_m;
           uiSet(UI_CAL_LEVEL);
         } else {
           uiSet(UI_MENU);
@@ -781,28 +1945,28 @@ static void handleEvent(BtnId b, EvType ev){
 
     if (ui == UI_CAL_EC){
       if (ev == EV_SHORT){
-        if (ecStep == EC_A_SET) { ecWizardA -= 10.0f; if (ecWizardA < 0) ecWizardA = 0; }
-        else if (ecStep == EC_B_SET) { ecWizardB -= 100.0f; if (ecWizardB < 0) ecWizardB = 0; }
+        if (ecStep == EC_A_SET) { ecWizardA -= 10; if (ecWizardA < 0) ecWizardA = 0; }
+        else if (ecStep == EC_B_SET) { ecWizardB -= 100; if (ecWizardB < 0) ecWizardB = 0; }
         return;
       }
       if (ev == EV_LONG){
         if (ecStep == EC_A_SET) ecStep = EC_A_CAP;
         else if (ecStep == EC_A_CAP){
           ecCal.A.ec_us = ecWizardA;
-          ecCal.A.v     = sens.ec_v;
+          ecCal.A.uv    = sensorSlot<EcChannel>(sensorsRead().s).v.uv;
           ecCal.A.set   = true;
-          saveEcCal();
+          storePost(STORE_EC_CAL);
           ecStep = EC_B_SET;
         } else if (ecStep == EC_B_SET) ecStep = EC_B_CAP;
         else if (ecStep == EC_B_CAP){
           ecCal.B.ec_us = ecWizardB;
-          ecCal.B.v     = sens.ec_v;
+          ecCal.B.uv    = sensorSlot<EcChannel>(sensorsRead().s).v.uv;
           ecCal.B.set   = true;
-          saveEcCal();
+          storePost(STORE_EC_CAL);
           ecStep = EC_DONE;
         } else {
           computeEcCal();
-          saveEcCal();
+          storePost(STORE_EC_CAL);
           uiSet(UI_MENU);
         }
         return;
@@ -813,19 +1977,19 @@ static void handleEvent(BtnId b, EvType ev){
     if (ui == UI_LEVEL_UNIT){
       if (ev == EV_SHORT){
         if (lvlCal.unit == UNIT_CUSTOM) {
-          lvlCal.custom_max -= 1.0f;
-          if (lvlCal.custom_max < 1.0f) lvlCal.custom_max = 1.0f;
+          lvlCal.custom_max_m -= FX_MILLI;
+          if (lvlCal.custom_max_m < FX_MILLI) lvlCal.custom_max_m = FX_MILLI;
         } else {
           lvlCal.unit = UNIT_CUSTOM;
         }
         return;
       }
       if (ev == EV_LONG){
-        saveLevelCal();
+        storePost(STORE_LEVEL_CAL);
         uiSet(UI_CAL_LEVEL);
         lvlStep = LVL_EMPTY_SET;
-        lvlWizardEmpty = 0.0f;
-        lvlWizardFull  = (lvlCal.unit==UNIT_PERCENT) ? 100.0f : lvlCal.custom_max;
+        lvlWizardEmpty = 0;
+        lvlWizardFull  = (lvlCal.unit==UNIT_PERCENT) ? 100 * FX_MILLI : lvlCal.custom_max_m;
         return;
       }
       return;
@@ -833,8 +1997,8 @@ static void handleEvent(BtnId b, EvType ev){
 
     if (ui == UI_CAL_LEVEL){
       if (ev == EV_SHORT){
-        if (lvlStep == LVL_EMPTY_SET) { lvlWizardEmpty -= 1.0f; if (lvlWizardEmpty < 0) lvlWizardEmpty = 0; }
-        else if (lvlStep == LVL_FULL_SET) { lvlWizardFull -= 1.0f; if (lvlWizardFull < 0) lvlWizardFull = 0; }
+        if (lvlStep == LVL_EMPTY_SET) { lvlWizardEmpty -= FX_MILLI; if (lvlWizardEmpty < 0) lvlWizardEmpty = 0; }
+        else if (lvlStep == LVL_FULL_SET) { lvlWizardFull -= FX_MILLI; if (lvlWizardFull < 0) lvlWizardFull = 0; }
         return;
       }
       if (ev == EV_LONG){
@@ -842,22 +2006,22 @@ static void handleEvent(BtnId b, EvType ev){
           uiSet(UI_LEVEL_UNIT);
         } else if (lvlStep == LVL_EMPTY_SET) lvlStep = LVL_EMPTY_CAP;
         else if (lvlStep == LVL_EMPTY_CAP){
-          lvlCal.empty.level = lvlWizardEmpty;
-          lvlCal.empty.v     = sens.lvl_v;
+          lvlCal.empty.level_m = lvlWizardEmpty;
+          lvlCal.empty.uv      = sensorSlot<LevelChannel>(sensorsRead().s).v.uv;
           lvlCal.empty.set   = true;
-          saveLevelCal();
+          storePost(STORE_LEVEL_CAL);
           lvlStep = LVL_FULL_SET;
         } else if (lvlStep == LVL_FULL_SET) lvlStep = LVL_FULL_CAP;
         else if (lvlStep == LVL_FULL_CAP){
-          lvlCal.full.level = lvlWizardFull;
-          lvlCal.full.v     = sens.lvl_v;
+          lvlCal.full.level_m = lvlWizardFull;
+          lvlCal.full.uv      = sensorSlot<LevelChannel>(sensorsRead().s).v.uv;
           lvlCal.full.set   = true;
-          saveLevelCal();
+          storePost(STORE_LEVEL_CAL);
           lvlStep = LVL_DONE;
         } else {
-          if (lvlCal.unit == UNIT_CUSTOM) lvlCal.custom_max = lvlWizardFull;
+          if (lvlCal.unit == UNIT_CUSTOM) lvlCal.custom_max_m = lvlWizardFull;
           computeLevelCal();
-          saveLevelCal();
+          storePost(STORE_LEVEL_CAL);
           uiSet(UI_MENU);
         }
         return;
@@ -870,6 +2034,47 @@ static void handleEvent(BtnId b, EvType ev){
   }
 }
 
+/**************************************************************
+ * RESET REASON / STALL BREADCRUMBS
+ **************************************************************/
+static const char* resetReasonName(esp_reset_reason_t r){
+  switch (r){
+    case ESP_RST_POWERON:   return "poweron";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "int_wdt";
+    case ESP_RST_TASK_WDT:  return "task_wdt";
+    case ESP_RST_WDT:       return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_SDIO:      return "sdio";
+    default:                return "unknown";
+  }
+}
+
+// Capacity for resetJson()
+static const size_t RESET_JSON_SIZE = JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(STALL_CRUMBS)
+                                    + STALL_CRUMBS * JSON_OBJECT_SIZE(6);
+
+// {reason, boot, crumbs:[oldest..newest]}; crumbs from earlier boots
+// are what was logged before the reset
+static void resetJson(JsonObject o){
+  o["reason"] = resetReasonName(resetReason);
+  o["boot"] = stallLog.boots;
+  JsonArray a = o.createNestedArray("crumbs");
+  for (uint8_t i=0;i<stallLog.count;i++){
+    const StallCrumb &c = stallLog.at(i);
+    JsonObject e = a.createNestedObject();
+    e["name"] = (const char*)c.name;   // not copied
+    e["kind"] = c.kind == STALL_HUNG ? "stall" : "overrun";
+    e["boot"] = c.boot;
+    e["t_ms"] = c.uptimeMs;
+    e["ms"] = c.elapsedMs;
+    e["budget_ms"] = c.budgetMs;
+  }
+}
+
 /**************************************************************
  * MQTT (FIXED: no UI stall)
  **************************************************************/
@@ -892,8 +2097,9 @@ static void mqttEnsure(){
 
   // ✅ Slow reconnect attempts (reduces stall frequency if broker down)
   uint32_t now = millis();
-  if (now - mqttSt.lastAttemptMs < 15000) return;
-  mqttSt.lastAttemptMs = now;
+  // first attempt as soon as WiFi is up
+  if (mqttSt.lastAttemptMs && now - mqttSt.lastAttemptMs < MQTT_RETRY_MS) return;
+  mqttSt.lastAttemptMs = now ? now : 1;
 
   String cid = String("hydronode-") + String((uint32_t)ESP.getEfuseMac(), HEX);
 
@@ -903,42 +2109,82 @@ static void mqttEnsure(){
 
   mqttSt.connected = ok;
   mqttSt.err = ok ? "" : String(mqtt.state());
+  if (ok) mqttSt.pubSeq = 0;   // republish (broker may have lost retained values)
+}
+
+// Per-channel topics <base><sub>; a topic that does not fit is not published
+struct MqttTopicSink {
+  const char* base;
+  void publish(const char* sub, const char* v){
+    FixedText<MQTT_TOPIC_LEN> topic;
+    topic.str(base).str(sub);
+    if (!topic.truncated()) mqtt.publish(topic.c_str(), v, mqttCfg.retain);
+  }
+};
+
+struct MqttTopics {
+  MqttTopicSink &sink;
+  template<class C> void operator()(const ChannelSlot<C> &slot){ C::toMqtt(slot.v, sink); }
+};
+
+// <base>/reset, once per boot (retained: the last reboot stays visible)
+static void mqttPublishReset(){
+  static bool sent = false;
+  if (sent) return;
+
+  StaticJsonDocument<RESET_JSON_SIZE> doc;
+  resetJson(doc.to<JsonObject>());
+  static char payload[MQTT_RESET_LEN];   // net task only
+  if (measureJson(doc) >= sizeof(payload)) { sent = true; return; }
+  serializeJson(doc, payload, sizeof(payload));
+
+  FixedText<MQTT_TOPIC_LEN> topic;
+  topic.str(mqttCfg.base_topic.c_str()).str("/reset");
+  if (topic.truncated()) { sent = true; return; }
+
+  // a packet over the client buffer fails every time: give up on it
+  size_t packet = MQTT_MAX_HEADER_SIZE + 2 + topic.length() + strlen(payload);
+  if (packet > mqtt.getBufferSize()) { sent = true; return; }
+  sent = mqtt.publish(topic.c_str(), payload, true);
 }
 
 static void mqttPublish(){
   if (!mqttSt.connected) return;
   if (apMode || WiFi.status() != WL_CONNECTED) return; // safety
 
+  mqttPublishReset();
+
+  // only new samples; pub_period_ms caps the rate
+  const SensorSnapshot snap = sensorsRead();
+  if (snap.seq == mqttSt.pubSeq) return;
+
   uint32_t now = millis();
-  if (now - mqttSt.lastPublishMs < mqttCfg.pub_period_ms) return;
-  mqttSt.lastPublishMs = now;
+  if (mqttSt.lastPublishMs && now - mqttSt.lastPublishMs < mqttCfg.pub_period_ms) return;
+  mqttSt.lastPublishMs = now ? now : 1;
+  mqttSt.pubSeq = snap.seq;
 
-  const String base = mqttCfg.base_topic;
+  char base[MQTT_TOPIC_LEN];
+  strlcpy(base, mqttCfg.base_topic.c_str(), sizeof(base));
 
   StaticJsonDocument<640> doc;
   doc["fw"] = FW_VERSION;
   doc["ip"] = wifiSt.ip;
   doc["wifi_mode"] = (uint8_t)wifiSt.mode;
   doc["mqtt"] = mqttSt.connected;
-  doc["ec_us"] = sens.ec_us;
-  doc["ec_v"] = sens.ec_v;
-  doc["level_percent"] = sens.lvl_percent;
-  doc["level_value"] = sens.lvl_value;
-  doc["level_v"] = sens.lvl_v;
-  doc["temp_c"] = sens.temp_c;
-
-  String payload;
-  serializeJson(doc, payload);
-
-  mqtt.publish((base + "/status").c_str(), payload.c_str(), mqttCfg.retain);
-  mqtt.publish((base + "/ec").c_str(), String(sens.ec_us, 0).c_str(), mqttCfg.retain);
-  mqtt.publish((base + "/level/percent").c_str(), String(sens.lvl_percent, 1).c_str(), mqttCfg.retain);
-  mqtt.publish((base + "/level/value").c_str(), String(sens.lvl_value, 2).c_str(), mqttCfg.retain);
-
-  // avoid publishing "nan"
-  if (!isnan(sens.temp_c)) {
-    mqtt.publish((base + "/temp_c").c_str(), String(sens.temp_c, 1).c_str(), mqttCfg.retain);
-  }
+  SensorSummaryJson summary = { doc };
+  SensorRegistry::forEachSlot(snap.s, summary);
+  doc["seq"] = snap.seq;
+  doc["t_us"] = snap.t_us;
+
+  static char payload[MQTT_PAYLOAD_LEN];   // net task only
+  if (!serializeJson(doc, payload, sizeof(payload))) return;
+
+  FixedText<MQTT_TOPIC_LEN> topic;
+  topic.str(base).str("/status");
+  if (mqtt.publish(topic.c_str(), payload, mqttCfg.retain)) boot.reach(BOOT_FIRST_PUBLISH);
+  MqttTopicSink sink = { base };
+  MqttTopics topics = { sink };
+  SensorRegistry::forEachSlot(snap.s, topics);
 }
 
 /**************************************************************
@@ -950,28 +2196,255 @@ static void sendJson(AsyncWebServerRequest *req, const JsonDocument& doc){
   req->send(200, "application/json", s);
 }
 
+// Copies a string member into dst if present; false if it does not fit
+static bool jsonText(JsonVariant v, char *dst, size_t cap){
+  if (v.isNull()) return true;
+  const char *t = v | "";
+  if (strlen(t) >= cap) return false;
+  strlcpy(dst, t, cap);
+  return true;
+}
+
+// server.on() with the handler timed into a "<METHOD> <uri>" slot
+static int8_t profRoute(const char* uri, WebRequestMethodComposite method){
+  String name = String(method == HTTP_POST ? "POST " : "GET ") + uri;
+  return prof.add(name.c_str(), PROF_HTTP);
+}
+
+static AsyncCallbackWebHandler& onTimed(const char* uri, WebRequestMethodComposite method,
+                                        ArRequestHandlerFunction fn){
+  const int8_t slot = profRoute(uri, method);
+  return server.on(uri, method, [slot, fn](AsyncWebServerRequest *req){
+    ProfScope t(prof, slot);
+    fn(req);
+  });
+}
+
+// JSON POSTs: the work happens in the body handler
+static AsyncCallbackWebHandler& onTimed(const char* uri, WebRequestMethodComposite method,
+                                        ArRequestHandlerFunction fn, ArUploadHandlerFunction upload,
+                                        ArBodyHandlerFunction body){
+  const int8_t slot = profRoute(uri, method);
+  return server.on(uri, method, fn, upload,
+    [slot, body](AsyncWebServerRequest *req, uint8_t *data, size_t len, size_t index, size_t total){
+      ProfScope t(prof, slot);
+      body(req, data, len, index, total);
+    });
+}
+
+// GET /api/<name>: snapshot header + the channel's own fields
+struct SensorRoutes {
+  template<class C> void channel(){
+    onTimed((String("/api/") + C::name()).c_str(), HTTP_GET, [](AsyncWebServerRequest *req){
+      const SensorSnapshot snap = sensorsRead();
+      const ChannelSlot<C> &slot = sensorSlot<C>(snap.s);
+      StaticJsonDocument<1024> doc;
+      doc["ok"] = true;
+      doc["seq"] = snap.seq;
+      doc["t_us"] = snap.t_us;
+      doc["sample_t_us"] = slot.meta.t_us;
+      doc["interval_ms"] = slot.meta.interval_ms;
+      C::toJson(slot.v, doc);
+      sendJson(req, doc);
+    });
+  }
+};
+
+/**************************************************************
+ * WEB: METRICS
+ **************************************************************/
+// Indexed by ProfKind; JSON group and Prometheus `kind` label
+static const char* const PROF_KIND_NAMES[] = { "job", "task", "http" };
+
+// hist[k] counts runs shorter than 2^k us (last entry: longer);
+// trailing empty buckets are left out
+static void sendMetricsJson(AsyncWebServerRequest *req){
+  const uint8_t n = prof.count();
+  size_t cap = JSON_OBJECT_SIZE(13) + JSON_ARRAY_SIZE(PROF_BUCKETS) + 3 * JSON_OBJECT_SIZE(n);
+  for (uint8_t i=0;i<n;i++) cap += JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(prof.usedBuckets(i));
+  cap += JSON_OBJECT_SIZE(stallWdt.count()) + stallWdt.count() * JSON_OBJECT_SIZE(3);
+  cap += JSON_OBJECT_SIZE(BC_N) + BC_N * JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(2);
+  cap += JSON_OBJECT_SIZE(2 + BOOT_MS_N) + JSON_OBJECT_SIZE(BOOT_MAX_PHASES);
+  cap += JSON_OBJECT_SIZE(14);
+
+  DynamicJsonDocument doc(cap);
+  doc["ok"] = true;
+  doc["uptime_ms"] = millis();
+  doc["cpu_mhz"] = prof.cyclesPerUs();
+
+  JsonArray le = doc.createNestedArray("hist_lt_us");
+  for (uint8_t b=0;b+1<PROF_BUCKETS;b++) le.add(Profiler::bucketLimitUs(b));
+
+  JsonObject group[3];
+  for (uint8_t k=0;k<3;k++) group[k] = doc.createNestedObject(PROF_KIND_NAMES[k]);
+
+  uint32_t lateMax = 0;
+  for (uint8_t i=0;i<n;i++){
+    const ProfSlot &s = prof.slot(i);
+    JsonObject o = group[s.kind].createNestedObject((const char*)s.name);   // not copied
+    o["n"] = s.count;
+    o["sum_us"] = s.sumCycles / prof.cyclesPerUs();
+    o["max_us"] = s.maxUs;
+    if (s.kind == PROF_TASK){
+      o["period_max_us"] = s.periodMaxUs;
+      o["late_max_us"] = s.lateMaxUs;
+      if (s.lateMaxUs > lateMax) lateMax = s.lateMaxUs;
+    }
+    JsonArray h = o.createNestedArray("hist");
+    for (uint8_t b=0;b<prof.usedBuckets(i);b++) h.add(s.bucket[b]);
+  }
+  doc["late_max_us"] = lateMax;
+
+  JsonObject budget = doc.createNestedObject("budget");
+  for (uint8_t i=0;i<stallWdt.count();i++){
+    JsonObject o = budget.createNestedObject(stallWdt.name(i));
+    o["budget_ms"] = stallWdt.budgetMs(i);
+    o["overruns"] = stallWdt.overruns(i);
+    o["worst_ms"] = stallWdt.worstMs(i);
+  }
+
+  JsonObject inbox = doc.createNestedObject("bus");
+  for (uint8_t c=0;c<BC_N;c++){
+    JsonObject o = inbox.createNestedObject(BUS_CONSUMER_NAMES[c]);
+    o["depth"] = bus.depth(c);
+    o["drops"] = bus.drops(c);
+  }
+
+  uint32_t glitches = 0;
+  for (uint8_t i=0;i<BTN_N;i++) glitches += btns[i].trk.glitchCount();
+  doc["buttons"]["edge_drops"] = btnEdges.dropCount();
+  doc["buttons"]["glitches"] = glitches;
+
+  // lcd: frames rendered / idle ticks, shadow flushes, runs and
+  // cells posted; writer queue; I2C
+  JsonObject lo = doc.createNestedObject("lcd");
+  lo["frames"] = lcdFrames;
+  lo["idle_ticks"] = lcdIdleTicks;
+  lo["flushes"] = lcdShadow.flushCount();
+  lo["runs"] = lcdShadow.runCount();
+  lo["cells"] = lcdShadow.cellCount();
+  lo["queue_depth"] = lcdQueue.size();
+  lo["queue_drops"] = lcdQueue.dropCount();
+  lo["coalesced"] = lcdPending.coalescedCount();
+  lo["up"] = lcdUp;
+  lo["recoveries"] = lcdRecoveries;
+  lo["i2c_writes"] = lcd.writeCount();
+  lo["i2c_bytes"] = lcd.byteCount();
+  lo["i2c_errors"] = lcd.errorCount();
+  lo["full_refresh_us"] = lcdFullRefreshUs;
+
+  // boot: setup() phase durations, milestones in us since start
+  JsonObject b = doc.createNestedObject("boot");
+  JsonObject ph = b.createNestedObject("phases_us");
+  for (uint8_t i=0;i<boot.phases();i++) ph[boot.phaseName(i)] = boot.phaseUs(i);
+  if (boot.phases()) b["setup_us"] = boot.phaseEndUs(boot.phases() - 1);
+  for (uint8_t i=0;i<BOOT_MS_N;i++){
+    if (boot.reached(i)) b[BOOT_MILESTONE_NAMES[i]] = boot.milestoneUs(i);
+  }
+
+  sendJson(req, doc);
+}
+
+static void promSeconds(Print &out, uint64_t us){
+  out.printf("%lu.%06lu", (unsigned long)(us / 1000000), (unsigned long)(us % 1000000));
+}
+
+static void promSeries(Print &out, const char* metric, const ProfSlot &s){
+  out.printf("hydronode_%s{kind=\"%s\",name=\"%s\"", metric, PROF_KIND_NAMES[s.kind], s.name);
+}
+
+static void promGauge(Print &out, const char* metric, const ProfSlot &s, uint64_t us){
+  promSeries(out, metric, s);
+  out.print("} ");
+  promSeconds(out, us);
+  out.print("\n");
+}
+
+// Prometheus text format (0.0.4): one histogram family for all slots
+static void sendMetricsProm(AsyncWebServerRequest *req){
+  AsyncResponseStream *out = req->beginResponseStream("text/plain; version=0.0.4");
+  const uint8_t n = prof.count();
+  const uint32_t cpu = prof.cyclesPerUs();
+
+  out->print("# HELP hydronode_run_seconds Run time per job, task wake, timer callback and HTTP handler\n");
+  out->print("# TYPE hydronode_run_seconds histogram\n");
+  for (uint8_t i=0;i<n;i++){
+    const ProfSlot &s = prof.slot(i);
+    const uint8_t used = prof.usedBuckets(i);
+    uint32_t cum = 0;
+    for (uint8_t b=0;b<used && b+1<PROF_BUCKETS;b++){
+      cum += s.bucket[b];
+      promSeries(*out, "run_seconds_bucket", s);
+      out->print(",le=\"");
+      promSeconds(*out, Profiler::bucketLimitUs(b) - 1);   // whole us below the limit
+      out->printf("\"} %lu\n", (unsigned long)cum);
+    }
+    promSeries(*out, "run_seconds_bucket", s);
+    out->printf(",le=\"+Inf\"} %lu\n", (unsigned long)s.count);
+    promGauge(*out, "run_seconds_sum", s, s.sumCycles / cpu);
+    promSeries(*out, "run_seconds_count", s);
+    out->printf("} %lu\n", (unsigned long)s.count);
+  }
+
+  out->print("# TYPE hydronode_run_max_seconds gauge\n");
+  for (uint8_t i=0;i<n;i++) promGauge(*out, "run_max_seconds", prof.slot(i), prof.slot(i).maxUs);
+
+  out->print("# TYPE hydronode_wake_period_max_seconds gauge\n");
+  for (uint8_t i=0;i<n;i++){
+    const ProfSlot &s = prof.slot(i);
+    if (s.kind == PROF_TASK) promGauge(*out, "wake_period_max_seconds", s, s.periodMaxUs);
+  }
+
+  out->print("# TYPE hydronode_wake_late_max_seconds gauge\n");
+  for (uint8_t i=0;i<n;i++){
+    const ProfSlot &s = prof.slot(i);
+    if (s.kind == PROF_TASK) promGauge(*out, "wake_late_max_seconds", s, s.lateMaxUs);
+  }
+
+  req->send(out);
+}
+
 /**************************************************************
  * WEB: ROUTES
  **************************************************************/
-static void setupRoutes(){
-  if (apMode) {
-    server.serveStatic("/", LittleFS, "/www/").setDefaultFile("ap.html");
-  } else {
-    server.serveStatic("/", LittleFS, "/www/")
-          .setDefaultFile("index.html")
-          .setAuthentication(UI_USER, UI_PASS);
+// LittleFS is mounted by the first request for a static file rather
+// than at boot. All handlers run in the AsyncTCP task, so no lock.
+static bool fsMount(){
+  static int8_t state = -1;   // -1: not tried, 0: failed, 1: mounted
+  if (state < 0){
+    state = LittleFS.begin(true) ? 1 : 0;
+    boot.reach(BOOT_FS_MOUNT);
+    if (!state) Serial.println("LittleFS mount failed");
   }
+  return state > 0;
+}
+
+static bool staticRequest(AsyncWebServerRequest *req){
+  return !req->url().startsWith("/api/") && req->url() != "/metrics";
+}
+
+// Registered before the WiFi mode is known: both UIs are installed
+// and a filter picks one per request, so nothing has to be swapped
+// in the server's handler list while AsyncTCP is walking it
+static void setupRoutes(){
+  server.serveStatic("/", LittleFS, "/www/")
+        .setDefaultFile("ap.html")
+        .setFilter([](AsyncWebServerRequest *req){ return wifiPhase == WP_AP && staticRequest(req) && fsMount(); });
+  server.serveStatic("/", LittleFS, "/www/")
+        .setDefaultFile("index.html")
+        .setAuthentication(UI_USER, UI_PASS)
+        .setFilter([](AsyncWebServerRequest *req){ return wifiPhase != WP_AP && staticRequest(req) && fsMount(); });
 
   server.onNotFound([](AsyncWebServerRequest *req){
     if (apMode){
-      if (LittleFS.exists("/www/ap.html")) req->send(LittleFS, "/www/ap.html", "text/html");
+      if (fsMount() && LittleFS.exists("/www/ap.html")) req->send(LittleFS, "/www/ap.html", "text/html");
       else req->send(200, "text/plain", "AP mode: upload /www/ap.html");
       return;
     }
     req->send(404, "text/plain", "Not found");
   });
 
-  server.on("/api/wifi", HTTP_POST,
+  onTimed("/api/wifi", HTTP_POST,
     [](AsyncWebServerRequest *req){},
     NULL,
     [](AsyncWebServerRequest *req, uint8_t *data, size_t len, size_t, size_t){
@@ -997,20 +2470,32 @@ static void setupRoutes(){
         return;
       }
 
-      saveWiFiCreds(ssid, pass);
+      StoreMsg m;
+      m.cmd = STORE_WIFI_CREDS;
+      if (ssid.length() >= sizeof(m.ssid) || pass.length() >= sizeof(m.pass)){
+        out["ok"] = false;
+        out["err"] = "too_long";
+        sendJson(req, out);
+        return;
+      }
+      strlcpy(m.ssid, ssid.c_str(), sizeof(m.ssid));
+      strlcpy(m.pass, pass.c_str(), sizeof(m.pass));
+      if (!storeSend(m)){
+        out["ok"] = false;
+        out["err"] = "store_busy";
+        sendJson(req, out);
+        return;
+      }
 
       out["ok"] = true;
       out["saved"] = true;
-      out["rebooting"] = true;
+      out["rebooting"] = true;   // the net task restarts once the reply is out
       sendJson(req, out);
-
-      delay(400);
-      ESP.restart();
     }
   );
 
-  server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *req){
-    StaticJsonDocument<896> doc;
+  onTimed("/api/status", HTTP_GET, [](AsyncWebServerRequest *req){
+    StaticJsonDocument<1024 + RESET_JSON_SIZE> doc;
     doc["ok"] = true;
     doc["fw"] = FW_VERSION;
     doc["api"] = API_VERSION;
@@ -1020,44 +2505,36 @@ static void setupRoutes(){
     doc["wifi"]["ip"] = wifiSt.ip;
     doc["wifi"]["ssid"] = wifiSt.ssid;
 
-    doc["mqtt"]["enabled"] = mqttCfg.enabled;
+    MqttFields mf;
+    mqttShown.read(mf);
+    doc["mqtt"]["enabled"] = mf.enabled;
     doc["mqtt"]["connected"] = mqttSt.connected;
-    doc["mqtt"]["base_topic"] = mqttCfg.base_topic;
+    doc["mqtt"]["base_topic"] = (const char*)mf.topic;
     doc["mqtt"]["err"] = mqttSt.err;
 
-    doc["temp_c"] = sens.temp_c;
-    sendJson(req, doc);
-  });
+    const SensorSnapshot snap = sensorsRead();
+    SensorIntervalJson intervals = { doc.createNestedObject("sampling_ms") };
+    SensorRegistry::forEachSlot(snap.s, intervals);
 
-  server.on("/api/ec", HTTP_GET, [](AsyncWebServerRequest *req){
-    StaticJsonDocument<512> doc;
-    doc["ok"] = true;
-    doc["us_cm"] = sens.ec_us;
-    doc["v"] = sens.ec_v;
-    doc["adc_raw"] = sens.ec_adc_raw;
-    sendJson(req, doc);
-  });
+    doc["adc"]["bits"] = sensorSlot<EcChannel>(snap.s).v.adc_bits;
+    doc["adc"]["cal"] = (uint8_t)adcChar.source();
 
-  server.on("/api/level", HTTP_GET, [](AsyncWebServerRequest *req){
-    StaticJsonDocument<512> doc;
-    doc["ok"] = true;
-    doc["percent"] = sens.lvl_percent;
-    doc["value"] = sens.lvl_value;
-    doc["v"] = sens.lvl_v;
-    doc["adc_raw"] = sens.lvl_adc_raw;
-    doc["unit"] = (uint8_t)lvlCal.unit;
-    doc["custom_max"] = lvlCal.custom_max;
+    SensorSummaryJson summary = { doc };
+    SensorRegistry::forEachSlot(snap.s, summary);
+    doc["seq"] = snap.seq;
+    doc["t_us"] = snap.t_us;
+    resetJson(doc.createNestedObject("reset"));
     sendJson(req, doc);
   });
 
-  server.on("/api/temp", HTTP_GET, [](AsyncWebServerRequest *req){
-    StaticJsonDocument<256> doc;
-    doc["ok"] = true;
-    doc["temp_c"] = sens.temp_c;
-    sendJson(req, doc);
-  });
+  onTimed("/api/metrics", HTTP_GET, sendMetricsJson);
+  onTimed("/metrics", HTTP_GET, sendMetricsProm);
+
+  // /api/ec, /api/level, /api/temp, ... one per registered channel
+  SensorRoutes channelRoutes;
+  SensorRegistry::forEachChannel(channelRoutes);
 
-  server.on("/api/cal", HTTP_GET, [](AsyncWebServerRequest *req){
+  onTimed("/api/cal", HTTP_GET, [](AsyncWebServerRequest *req){
     StaticJsonDocument<768> doc;
     doc["ok"] = true;
 
@@ -1065,40 +2542,203 @@ static void setupRoutes(){
     doc["ec"]["B_set"] = ecCal.B.set;
     doc["ec"]["A_ec"]  = ecCal.A.ec_us;
     doc["ec"]["B_ec"]  = ecCal.B.ec_us;
-    doc["ec"]["A_v"]   = ecCal.A.v;
-    doc["ec"]["B_v"]   = ecCal.B.v;
+    doc["ec"]["A_v"]   = fxToFloat(ecCal.A.uv, FX_UV_PER_V);
+    doc["ec"]["B_v"]   = fxToFloat(ecCal.B.uv, FX_UV_PER_V);
     doc["ec"]["valid"] = ecCal.valid;
     doc["ec"]["quality"] = (uint8_t)ecCal.quality;
 
     doc["level"]["E_set"] = lvlCal.empty.set;
     doc["level"]["F_set"] = lvlCal.full.set;
-    doc["level"]["E_lvl"] = lvlCal.empty.level;
-    doc["level"]["F_lvl"] = lvlCal.full.level;
-    doc["level"]["E_v"]   = lvlCal.empty.v;
-    doc["level"]["F_v"]   = lvlCal.full.v;
+    doc["level"]["E_lvl"] = fxToFloat(lvlCal.empty.level_m, FX_MILLI);
+    doc["level"]["F_lvl"] = fxToFloat(lvlCal.full.level_m, FX_MILLI);
+    doc["level"]["E_v"]   = fxToFloat(lvlCal.empty.uv, FX_UV_PER_V);
+    doc["level"]["F_v"]   = fxToFloat(lvlCal.full.uv, FX_UV_PER_V);
     doc["level"]["valid"] = lvlCal.valid;
     doc["level"]["quality"] = (uint8_t)lvlCal.quality;
     doc["level"]["unit"] = (uint8_t)lvlCal.unit;
-    doc["level"]["custom_max"] = lvlCal.custom_max;
+    doc["level"]["custom_max"] = fxToFloat(lvlCal.custom_max_m, FX_MILLI);
 
     sendJson(req, doc);
   });
 
-  server.on("/api/settings/mqtt", HTTP_GET, [](AsyncWebServerRequest *req){
+  onTimed("/api/settings/adc", HTTP_GET, [](AsyncWebServerRequest *req){
+    StaticJsonDocument<256> doc;
+    doc["ok"] = true;
+    doc["oversample_bits"] = adcOsBits;
+    doc["oversample_max"] = ADC_OS_BITS_MAX;
+    doc["adc_bits"] = sensorSlot<EcChannel>(sensorsRead().s).v.adc_bits;
+    doc["dma"] = adcSampler.isRunning();
+    sendJson(req, doc);
+  });
+
+  onTimed("/api/settings/adc", HTTP_POST,
+    [](AsyncWebServerRequest *req){},
+    NULL,
+    [](AsyncWebServerRequest *req, uint8_t *data, size_t len, size_t, size_t){
+      StaticJsonDocument<128> in;
+      auto err = deserializeJson(in, data, len);
+
+      StaticJsonDocument<128> out;
+      if (err || !in.containsKey("oversample_bits")){
+        out["ok"] = false;
+        out["err"] = err ? "bad_json" : "oversample_bits_required";
+        sendJson(req, out);
+        return;
+      }
+
+      int bits = in["oversample_bits"].as<int>();
+      if (bits < 0 || bits > ADC_OS_BITS_MAX){
+        out["ok"] = false;
+        out["err"] = "out_of_range";
+        sendJson(req, out);
+        return;
+      }
+
+      StoreMsg m;
+      m.cmd = STORE_ADC_CFG;
+      m.adcOs = (uint8_t)bits;
+      if (!storeSend(m)){
+        out["ok"] = false;
+        out["err"] = "store_busy";
+        sendJson(req, out);
+        return;
+      }
+      adcOsCfg = (uint8_t)bits;
+      adcOsPending = (int8_t)bits;   // applied by the sampler
+
+      out["ok"] = true;
+      out["oversample_bits"] = bits;
+      sendJson(req, out);
+    }
+  );
+
+  onTimed("/api/settings/sampling", HTTP_GET, [](AsyncWebServerRequest *req){
     StaticJsonDocument<512> doc;
     doc["ok"] = true;
-    doc["enabled"] = mqttCfg.enabled;
-    doc["host"] = mqttCfg.host;
-    doc["port"] = mqttCfg.port;
-    doc["user"] = mqttCfg.user;
-    doc["pass"] = mqttCfg.pass;
-    doc["base_topic"] = mqttCfg.base_topic;
-    doc["retain"] = mqttCfg.retain;
-    doc["pub_period_ms"] = mqttCfg.pub_period_ms;
+    for (uint8_t i=0;i<SCH_N;i++){
+      JsonObject c = doc.createNestedObject(SAMPLE_CH_NAMES[i]);
+      c["interval_ms"] = sampleRate[i].intervalMs();
+      c["min_ms"] = sampleRate[i].minMs();
+      c["max_ms"] = sampleRate[i].maxMs();
+    }
     sendJson(req, doc);
   });
 
-  server.on("/api/settings/mqtt", HTTP_POST,
+  onTimed("/api/settings/sampling", HTTP_POST,
+    [](AsyncWebServerRequest *req){},
+    NULL,
+    [](AsyncWebServerRequest *req, uint8_t *data, size_t len, size_t, size_t){
+      StaticJsonDocument<384> in;
+      auto err = deserializeJson(in, data, len);
+
+      StaticJsonDocument<128> out;
+      if (err){
+        out["ok"] = false;
+        out["err"] = "bad_json";
+        sendJson(req, out);
+        return;
+      }
+
+      // unchanged channels keep the last staged (or loaded) bounds
+      StoreMsg m;
+      m.cmd = STORE_SAMPLING;
+      if (!sampleStage.read(m.smp)){
+        for (uint8_t i=0;i<SCH_N;i++){
+          m.smp.ch[i].minMs = sampleRate[i].minMs();
+          m.smp.ch[i].maxMs = sampleRate[i].maxMs();
+        }
+      }
+      for (uint8_t i=0;i<SCH_N;i++){
+        if (!in.containsKey(SAMPLE_CH_NAMES[i])) continue;
+        JsonVariant c = in[SAMPLE_CH_NAMES[i]];
+        uint32_t lo = c["min_ms"] | (int)m.smp.ch[i].minMs;
+        uint32_t hi = c["max_ms"] | (int)m.smp.ch[i].maxMs;
+        if (lo < TICK_SENSOR_MS || hi < lo || hi > SAMPLE_MS_LIMIT){
+          out["ok"] = false;
+          out["err"] = "out_of_range";
+          sendJson(req, out);
+          return;
+        }
+        m.smp.ch[i].minMs = lo;
+        m.smp.ch[i].maxMs = hi;
+      }
+
+      if (!storeSend(m)){
+        out["ok"] = false;
+        out["err"] = "store_busy";
+        sendJson(req, out);
+        return;
+      }
+      sampleStage.publish(m.smp);   // applied by the owning tasks
+      out["ok"] = true;
+      sendJson(req, out);
+    }
+  );
+
+  onTimed("/api/settings/lcd", HTTP_GET, [](AsyncWebServerRequest *req){
+    StaticJsonDocument<128> doc;
+    doc["ok"] = true;
+    doc["max_hz"] = lcdMaxHz;
+    doc["max_hz_limit"] = LCD_MAX_HZ_LIMIT;
+    sendJson(req, doc);
+  });
+
+  onTimed("/api/settings/lcd", HTTP_POST,
+    [](AsyncWebServerRequest *req){},
+    NULL,
+    [](AsyncWebServerRequest *req, uint8_t *data, size_t len, size_t, size_t){
+      StaticJsonDocument<128> in;
+      auto err = deserializeJson(in, data, len);
+
+      StaticJsonDocument<128> out;
+      if (err || !in.containsKey("max_hz")){
+        out["ok"] = false;
+        out["err"] = err ? "bad_json" : "max_hz_required";
+        sendJson(req, out);
+        return;
+      }
+
+      int hz = in["max_hz"].as<int>();
+      if (hz < 1 || hz > LCD_MAX_HZ_LIMIT){
+        out["ok"] = false;
+        out["err"] = "out_of_range";
+        sendJson(req, out);
+        return;
+      }
+
+      StoreMsg m;
+      m.cmd = STORE_LCD_CFG;
+      m.lcdHz = (uint8_t)hz;
+      if (!storeSend(m)){
+        out["ok"] = false;
+        out["err"] = "store_busy";
+        sendJson(req, out);
+        return;
+      }
+      lcdMaxHz = (uint8_t)hz;
+      out["ok"] = true;
+      out["max_hz"] = hz;
+      sendJson(req, out);
+    }
+  );
+
+  onTimed("/api/settings/mqtt", HTTP_GET, [](AsyncWebServerRequest *req){
+    MqttFields f;
+    mqttShown.read(f);
+    StaticJsonDocument<512> doc;
+    doc["ok"] = true;
+    doc["enabled"] = f.enabled;
+    doc["host"] = (const char*)f.host;
+    doc["port"] = f.port;
+    doc["user"] = (const char*)f.user;
+    doc["pass"] = (const char*)f.pass;
+    doc["base_topic"] = (const char*)f.topic;
+    doc["retain"] = f.retain;
+    doc["pub_period_ms"] = f.periodMs;
+    sendJson(req, doc);
+  });
+
+  onTimed("/api/settings/mqtt", HTTP_POST,
     [](AsyncWebServerRequest *req){},
     NULL,
     [](AsyncWebServerRequest *req, uint8_t *data, size_t len, size_t, size_t){
@@ -1113,16 +2753,32 @@ static void setupRoutes(){
         return;
       }
 
-      if (in.containsKey("enabled")) mqttCfg.enabled = in["enabled"].as<bool>();
-      if (in.containsKey("host")) mqttCfg.host = String((const char*)in["host"]);
-      if (in.containsKey("port")) mqttCfg.port = (uint16_t)in["port"].as<int>();
-      if (in.containsKey("user")) mqttCfg.user = String((const char*)in["user"]);
-      if (in.containsKey("pass")) mqttCfg.pass = String((const char*)in["pass"]);
-      if (in.containsKey("base_topic")) mqttCfg.base_topic = String((const char*)in["base_topic"]);
-      if (in.containsKey("retain")) mqttCfg.retain = in["retain"].as<bool>();
-      if (in.containsKey("pub_period_ms")) mqttCfg.pub_period_ms = (uint16_t)in["pub_period_ms"].as<int>();
+      // unchanged keys keep what the net task last applied
+      StoreMsg m;
+      m.cmd = STORE_MQTT_CFG;
+      MqttFields &f = m.mqtt;
+      mqttShown.read(f);
+      bool fits = jsonText(in["host"], f.host, sizeof(f.host))
+               && jsonText(in["user"], f.user, sizeof(f.user))
+               && jsonText(in["pass"], f.pass, sizeof(f.pass))
+               && jsonText(in["base_topic"], f.topic, sizeof(f.topic));
+      if (!fits){
+        out["ok"] = false;
+        out["err"] = "too_long";
+        sendJson(req, out);
+        return;
+      }
+      if (in.containsKey("enabled")) f.enabled = in["enabled"].as<bool>();
+      if (in.containsKey("port")) f.port = (uint16_t)in["port"].as<int>();
+      if (in.containsKey("retain")) f.retain = in["retain"].as<bool>();
+      if (in.containsKey("pub_period_ms")) f.periodMs = (uint16_t)in["pub_period_ms"].as<int>();
 
-      saveMqtt();
+      if (!storeSend(m)){
+        out["ok"] = false;
+        out["err"] = "store_busy";
+        sendJson(req, out);
+        return;
+      }
       out["ok"] = true;
       sendJson(req, out);
     }
@@ -1130,95 +2786,457 @@ static void setupRoutes(){
 }
 
 /**************************************************************
- * SETUP / LOOP
+ * TASKS
  **************************************************************/
-static void lcdInit(){
-  Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
-  lcd.init();
-  lcd.backlight();
-  lcd.clear();
-  lcdSetLine(0, "HydroNode");
-  lcdSetLine(1, "EC + Water Level");
-  lcdSetLine(2, "Booting...");
-  lcdSetLine(3, "");
+// Mailbox for the UI; only posted when something changed
+static void netViewPublish(){
+  static NetView last;
+  static bool posted = false;
+
+  NetView v;
+  v.sta = (wifiSt.mode==WifiStatus::WIFI_STA && wifiSt.connected);
+  v.ap = (wifiPhase == WP_AP);
+  v.mqtt = mqttSt.connected;
+  strlcpy(v.ip, wifiSt.ip, sizeof(v.ip));
+  strlcpy(v.topic, mqttCfg.base_topic.c_str(), sizeof(v.topic));
+
+  if (posted && memcmp(&v, &last, sizeof(v)) == 0) return;
+  last = v;
+  posted = true;
+  xQueueOverwrite(netViewBox, &v);
+  busPost(BP_NET, BUS_WIFI, v.sta, v.mqtt);
 }
 
-void setup(){
-  Serial.begin(115200);
+// Saves, then tells the UI (and for MQTT this task's own reconnect)
+static void storeHandle(const StoreMsg &m){
+  ConfigId id = CFG_CAL;
+  switch (m.cmd){
+    case STORE_EC_CAL:    saveEcCal(m.ec); break;
+    case STORE_LEVEL_CAL: saveLevelCal(m.lvl); break;
+    case STORE_WIFI_WIPE: wipeWiFiAndRestart(); return;
+    case STORE_WIFI_CREDS:
+      saveWiFiCreds(m.ssid, m.pass);
+      delay(400);
+      ESP.restart();
+      return;
+    case STORE_DS18_SLOTS: saveDs18Slots(m.roms); return;
+    case STORE_ADC_CFG:   saveAdcCfg(m.adcOs); id = CFG_ADC; break;
+    case STORE_SAMPLING:  saveSampling(m.smp); id = CFG_SAMPLING; break;
+    case STORE_LCD_CFG:   saveLcdCfg(m.lcdHz); id = CFG_LCD; break;
+    case STORE_MQTT_CFG:  mqttApply(m.mqtt); saveMqtt(); id = CFG_MQTT; break;
+  }
+  busPost(BP_NET, BUS_CONFIG, id);
+}
 
-  pinMode(PIN_BTN_LIGHT, INPUT_PULLUP);
-  pinMode(PIN_BTN_UP, INPUT_PULLUP);
-  pinMode(PIN_BTN_DN, INPUT_PULLUP);
+// Profiler and watchdog slots of one task and its jobs; also the
+// scheduler's run hook, so every job is timed and guarded without
+// wrapping it
+template<size_t N>
+struct SchedHook {
+  int8_t task = -1;      // busy time per wake, wake period, lateness
+  int8_t job[N];         // profiler slot by scheduler job id
+  int8_t guard[N];       // watchdog slot by scheduler job id
+  uint32_t dueUs = 0;    // deadline the task last slept towards
+
+  SchedHook(){ for (size_t i=0;i<N;i++) job[i] = guard[i] = -1; }
+
+  void operator()(uint8_t id, void (*fn)()){
+    StallScope g(stallWdt, guard[id]);
+    ProfScope t(prof, job[id]);
+    fn();
+  }
+};
 
-  analogReadResolution(12);
+// One scheduler per task; jobs are registered in tasksStart()
+static DeadlineScheduler<3> acqSched;
+static DeadlineScheduler<2> uiSched;
+static DeadlineScheduler<2> netSched;
+static SchedHook<3> acqProf;
+static SchedHook<2> uiProf;
+static SchedHook<2> netProf;
+static int8_t jobTemp = -1;
+static int8_t jobLcd = -1;
+static int8_t jobBtn = -1;
+static int8_t jobMqtt = -1;
+static int8_t jobWifi = -1;
+static int8_t profStore = -1;
+static int8_t profMqttEnsure = -1;
+static int8_t profMqttLoop = -1;
+static int8_t profMqttPublish = -1;
+static int8_t wdtStore = -1;
+static int8_t wdtMqttEnsure = -1;
+static int8_t wdtMqttLoop = -1;
+static int8_t wdtMqttPublish = -1;
+static int8_t wdtUiEvents = -1;
+static int8_t profLcdTask = -1;
+static int8_t wdtLcdWrite = -1;
+
+template<size_t N>
+static int8_t schedAdd(DeadlineScheduler<N> &sched, SchedHook<N> &sp, const char* name,
+                       typename DeadlineScheduler<N>::Job fn, uint32_t periodMs, uint32_t budgetMs,
+                       uint32_t now){
+  int8_t id = sched.add(fn, periodMs, now);
+  if (id < 0) return id;
+  sp.job[id] = prof.add(name, PROF_JOB);
+  sp.guard[id] = stallWdt.add(name, budgetMs);
+  return id;
+}
 
-  lcdInit();
+// One task wake: feed the task WDT, run what is due (timed), then
+// block until the earliest deadline or a task notification, but no
+// longer than WDT_FEED_MS so the WDT is fed whatever the job periods
+template<size_t N>
+static void schedRun(DeadlineScheduler<N> &sched, SchedHook<N> &sp){
+  esp_task_wdt_reset();
+  prof.wake(sp.task, (uint32_t)esp_timer_get_time(), sp.dueUs);
+  {
+    ProfScope busy(prof, sp.task);
+    sched.runDue(millis(), sp);
+  }
+  uint32_t ms = sched.msUntilNext(millis());
+  if (ms > WDT_FEED_MS) ms = WDT_FEED_MS;
+  sp.dueUs = (uint32_t)esp_timer_get_time() + ms * 1000;
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+}
 
-  ds18.begin();
-  ds18.setWaitForConversion(false);
-  ds18.requestTemperatures();
+// Acq jobs: the DS18B20 job sleeps until the bus state machine has
+// something to do (conversion start or result due)
+static void tempJob(){
+  tempTick();
+  acqSched.runAt(jobTemp, ds18.nextDue(millis()));
+}
 
-  loadMqtt();
-  mqtt.setSocketTimeout(1);          // ✅ key fix: reduce blocking time
-  loadEcCal();
-  loadLevelCal();
-  computeEcCal();
-  computeLevelCal();
+// UI jobs: presses go through the bus like every other UI input
+static void buttonRelease(uint8_t id, uint32_t heldUs){
+  EvType ev = classifyPress(heldUs);
+  if (ev != EV_NONE) busPost(BP_UI, BUS_BUTTON, id, ev);
+}
 
-  if (!LittleFS.begin(true)){
-    Serial.println("LittleFS mount failed");
+// Replays the ISR edges, then sleeps until a pending burst settles.
+// A pin that disagrees with its tracker with nothing pending lost an
+// edge (queue overflow); it is fed in as an edge stamped now.
+static void buttonsJob(){
+  uint32_t held;
+  ButtonEdge e;
+  while (btnEdges.pop(e)){
+    if (e.btn < BTN_N && btns[e.btn].trk.edge(e.pressed, e.t_us, held)) buttonRelease(e.btn, held);
   }
 
-  startSTA();
-  uint32_t t0 = millis();
-  while (millis() - t0 < 8000){
-    if (WiFi.status() == WL_CONNECTED) break;
-    delay(50);
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  uint32_t waitUs = 0;
+  for (uint8_t i=0;i<BTN_N;i++){
+    ButtonTracker &t = btns[i].trk;
+    bool level = digitalRead(btns[i].pin) == LOW;
+    if (!t.pending() && level != t.pressed() && t.edge(level, now, held)) buttonRelease(i, held);
+    if (t.settle(now, held)) buttonRelease(i, held);
+
+    uint32_t w = t.settleInUs(now);
+    if (t.pending() && (!waitUs || w < waitUs)) waitUs = w ? w : 1;
   }
-  if (WiFi.status() != WL_CONNECTED){
-    startAP();
+  if (waitUs) uiSched.runAt(jobBtn, millis() + (waitUs + 999) / 1000);
+}
+
+// Dirty inputs pull the LCD job in, but not before the refresh cap
+// allows the next frame
+static void lcdRequest(){
+  if (!lcdDirty) return;
+  const uint32_t gap = 1000u / lcdMaxHz;
+  const uint32_t now = millis();
+  uiSched.runBy(jobLcd, now - lcdFrameMs >= gap ? now : lcdFrameMs + gap);
+}
+
+// UI inbox: buttons drive the menus; every event marks the inputs
+// it changed dirty
+static void uiEvents(){
+  BusEvent e;
+  while (bus.poll(BC_UI, e)){
+    switch (e.kind){
+      case BUS_BUTTON: {
+        StallScope g(stallWdt, wdtUiEvents);
+        handleEvent((BtnId)e.a, (EvType)e.b);   // menus and wizards change only here
+        lcdDirty |= LCD_DIRTY_UI;
+        break;
+      }
+      case BUS_SAMPLE: lcdDirty |= LCD_DIRTY_SAMPLE; break;
+      case BUS_WIFI:   lcdDirty |= LCD_DIRTY_NET; break;
+      case BUS_CONFIG: lcdDirty |= LCD_DIRTY_UI; break;
+      default: break;
+    }
   }
+  lcdRequest();
+}
 
-  setupRoutes();
-  server.begin();
+// Net jobs
+static void mqttJob(){
+  { StallScope g(stallWdt, wdtMqttEnsure); ProfScope t(prof, profMqttEnsure); mqttEnsure(); }
+  { StallScope g(stallWdt, wdtMqttLoop); ProfScope t(prof, profMqttLoop); mqtt.loop(); }
+  { StallScope g(stallWdt, wdtMqttPublish); ProfScope t(prof, profMqttPublish); mqttPublish(); }
+  netViewPublish();   // MQTT up/down
+}
+
+// Milestones are stamped in several tasks; the net task prints them
+static void bootLog(){
+  static uint8_t printed = 0;
+  for (uint8_t i=0;i<BOOT_MS_N;i++){
+    if ((printed & (1u << i)) || !boot.reached(i)) continue;
+    printed |= 1u << i;
+    uint32_t us = boot.milestoneUs(i);
+    Serial.printf("boot: %-13s at %5lu.%lu ms\n", BOOT_MILESTONE_NAMES[i],
+                  (unsigned long)(us / 1000), (unsigned long)(us / 100 % 10));
+  }
+}
+
+static void wifiJob(){
+  wifiTick();
+  netViewPublish();
+  bootLog();
+
+  // captive portal DNS wants a short period; while STA connects, wake
+  // for the AP fallback deadline
+  if (wifiPhase == WP_AP) netSched.runAt(jobWifi, millis() + TICK_DNS_MS);
+  else if (wifiPhase == WP_STA_CONNECTING) netSched.runBy(jobWifi, wifiDeadlineMs);
+}
+
+// Net inbox: a new sample schedules a publish (no sooner than
+// pub_period_ms after the last one); WiFi events run the WiFi state
+// machine, WiFi changes and MQTT settings get the MQTT connection
+// looked at right away
+static void netEvents(){
+  BusEvent e;
+  const uint32_t now = millis();
+  while (bus.poll(BC_NET, e)){
+    if (e.kind == BUS_SAMPLE){
+      uint32_t due = mqttSt.lastPublishMs + mqttCfg.pub_period_ms;
+      netSched.runBy(jobMqtt, (int32_t)(due - now) > 0 ? due : now);
+    } else if (e.kind == BUS_WIFI){
+      netSched.runBy(jobMqtt, now);
+    } else if (e.kind == BUS_LINK){
+      netSched.runBy(jobWifi, now);
+    } else if (e.kind == BUS_CONFIG && e.a == CFG_MQTT){
+      mqtt.disconnect();
+      mqttSt.connected = false;
+      mqttSt.lastAttemptMs = now - MQTT_RETRY_MS;
+      netSched.runBy(jobMqtt, now);
+    }
+  }
+}
+
+// High: 1-Wire state machine (and sampling if the esp_timer is missing)
+static void acqTask(void*){
+  esp_task_wdt_add(NULL);
+  ds18.begin(DS18_PERIOD_MS, DS18_RESCAN_MS);   // bus search, overlaps the WiFi connect
+  boot.reach(BOOT_DS18_READY);
+  for (;;) schedRun(acqSched, acqProf);
+}
 
-  lcd.clear();
+// Medium: buttons and LCD; never touches WiFi, MQTT or NVS
+static void uiTask(void*){
+  esp_task_wdt_add(NULL);
+  lcdSplash();
   uiSet(UI_HOME);
+  for (;;){
+    if (btnEdges.size()) uiSched.runBy(jobBtn, millis());
+    uiEvents();
+    schedRun(uiSched, uiProf);
+  }
 }
 
-void loop(){
-  static uint32_t lastUi=0, lastSensor=0, lastMqtt=0;
-  uint32_t now = millis();
+// Below the UI: the only I2C user. Render code posts runs and returns,
+// so a slow or hung display costs this task time, not the UI's.
+// While the display is down, posts keep the frame current and
+// lcdStart() is retried every LCD_RETRY_MS.
+static void lcdTask(void*){
+  esp_task_wdt_add(NULL);
+  if (!lcdStart()) Serial.println("LCD not responding");   // overlaps the WiFi connect
+  boot.reach(BOOT_LCD_READY);
+  uint32_t retryAt = millis() + LCD_RETRY_MS;
+  for (;;){
+    esp_task_wdt_reset();
+    prof.wake(profLcdTask, (uint32_t)esp_timer_get_time(), 0);
+    {
+      ProfScope busy(prof, profLcdTask);
+      StallScope g(stallWdt, wdtLcdWrite);
+      lcdWrite();
+      if (!lcdUp && (int32_t)(millis() - retryAt) >= 0){
+        lcdStart();
+        retryAt = millis() + LCD_RETRY_MS;
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(lcdUp ? LCD_IDLE_MS : LCD_RETRY_MS));
+  }
+}
 
-  // ✅ Buttons FIRST (so UI stays responsive)
-  EvType e0 = pollButton(BTN_LIGHT);
-  EvType e1 = pollButton(BTN_UP);
-  EvType e2 = pollButton(BTN_DN);
+// Low: everything that can block on the network or flash. storePost()
+// and the bus notify this task, so NVS work and publishes do not wait
+// for the next deadline.
+static void netTask(void*){
+  esp_task_wdt_add(NULL);
+  for (;;){
+    StoreMsg m;
+    while (xQueueReceive(storeQueue, &m, 0) == pdTRUE){
+      StallScope g(stallWdt, wdtStore);
+      ProfScope t(prof, profStore);
+      storeHandle(m);
+    }
+    netEvents();
 
-  handleEvent(BTN_LIGHT, e0);
-  handleEvent(BTN_UP, e1);
-  handleEvent(BTN_DN, e2);
+    schedRun(netSched, netProf);
+  }
+}
 
-  // WiFi + captive portal
-  wifiTick();
+// IDF 5 changed the call to a config struct and no longer
+// reconfigures a WDT that the core already started
+static bool taskWdtStart(){
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_task_wdt_config_t cfg = {};
+  cfg.timeout_ms = WDT_TIMEOUT_S * 1000;
+  cfg.trigger_panic = true;
+  esp_err_t err = esp_task_wdt_reconfigure(&cfg);
+  if (err == ESP_ERR_INVALID_STATE) err = esp_task_wdt_init(&cfg);   // not started yet
+#else
+  esp_err_t err = esp_task_wdt_init(WDT_TIMEOUT_S, true);
+#endif
+  if (err != ESP_OK) Serial.printf("Task WDT init failed (%d)\n", (int)err);
+  return err == ESP_OK;
+}
 
-  // Sensors
-  if (now - lastSensor >= TICK_SENSOR_MS){
-    lastSensor = now;
-    sensorTick();
+// Highest: writes breadcrumbs for overruns and calls that are stuck,
+// so the crumb is in RTC memory before the task WDT resets the chip
+static void wdtTask(void*){
+  for (;;){
+    stallWdt.check(millis());
+    vTaskDelay(pdMS_TO_TICKS(WDT_CHECK_MS));
   }
+}
+
+static bool tasksStart(){
+  storeQueue = xQueueCreate(STORE_QUEUE_LEN, sizeof(StoreMsg));
+  netViewBox = xQueueCreate(1, sizeof(NetView));
+  if (!storeQueue || !netViewBox) return false;
+
+  netViewPublish();
+
+  acqProf.task = prof.add("acq", PROF_TASK);
+  uiProf.task = prof.add("ui", PROF_TASK);
+  profLcdTask = prof.add("lcd", PROF_TASK);
+  netProf.task = prof.add("net", PROF_TASK);
+  profStore = prof.add("store", PROF_JOB);
+  profMqttEnsure = prof.add("mqtt.ensure", PROF_JOB);
+  profMqttLoop = prof.add("mqtt.loop", PROF_JOB);
+  profMqttPublish = prof.add("mqtt.publish", PROF_JOB);
+  wdtStore = stallWdt.add("store", BUDGET_STORE_MS);
+  wdtMqttEnsure = stallWdt.add("mqtt.ensure", BUDGET_MQTT_MS);
+  wdtMqttLoop = stallWdt.add("mqtt.loop", BUDGET_MQTT_MS);
+  wdtMqttPublish = stallWdt.add("mqtt.publish", BUDGET_MQTT_MS);
+  wdtUiEvents = stallWdt.add("ui.events", BUDGET_BTN_MS);
+  wdtLcdWrite = stallWdt.add("lcd.write", BUDGET_LCD_MS);
+
+  const uint32_t now = millis();
+  jobTemp = schedAdd(acqSched, acqProf, "temp", tempJob, DS18_PERIOD_MS, BUDGET_TEMP_MS, now);
+  // esp_timer missing: sample from this task instead
+  if (!sampleTimer) schedAdd(acqSched, acqProf, "sensor", sensorTick, TICK_SENSOR_MS, BUDGET_SAMPLE_MS, now);
+#if HYDRO_MUX_INPUTS > 0
+  if (!muxTimer) schedAdd(acqSched, acqProf, "mux", muxTick, 1, BUDGET_MUX_MS, now);
+#endif
+
+  jobBtn = schedAdd(uiSched, uiProf, "buttons", buttonsJob, TICK_BTN_MS, BUDGET_BTN_MS, now);
+  jobLcd = schedAdd(uiSched, uiProf, "lcd.render", lcdTick, TICK_UI_MS, BUDGET_RENDER_MS, now);
+
+  jobWifi = schedAdd(netSched, netProf, "wifi", wifiJob, TICK_WIFI_MS, BUDGET_WIFI_MS, now);
+  // the job itself only bounds the sum; the steps have their own budgets
+  jobMqtt = schedAdd(netSched, netProf, "mqtt", mqttJob, TICK_MQTT_MS, 3 * BUDGET_MQTT_MS, now);
+
+  // without it the stall breadcrumbs still work, only the reset is lost
+  taskWdtStart();
+
+  return xTaskCreate(acqTask, "acq", TASK_ACQ_STACK, nullptr, TASK_ACQ_PRIO, nullptr) == pdPASS
+      && xTaskCreate(lcdTask, "lcd", TASK_LCD_STACK, nullptr, TASK_LCD_PRIO, &lcdTaskHandle) == pdPASS
+      && xTaskCreate(uiTask,  "ui",  TASK_UI_STACK,  nullptr, TASK_UI_PRIO,  &uiTaskHandle) == pdPASS
+      && xTaskCreate(netTask, "net", TASK_NET_STACK, nullptr, TASK_NET_PRIO, &netTaskHandle) == pdPASS
+      && xTaskCreate(wdtTask, "wdt", TASK_WDT_STACK, nullptr, TASK_WDT_PRIO, nullptr) == pdPASS;
+}
 
-  // LCD
-  if (now - lastUi >= TICK_UI_MS){
-    lastUi = now;
-    lcdTick();
+/**************************************************************
+ * SETUP / LOOP
+ **************************************************************/
+void setup(){
+  Serial.begin(115200);
+  prof.begin(ESP.getCpuFreqMHz());
+
+  // RTC memory is garbage after power-on; keep it across other resets
+  resetReason = esp_reset_reason();
+  stallLog.begin(resetReason != ESP_RST_POWERON && resetReason != ESP_RST_BROWNOUT);
+  stallWdt.begin(stallLog, WDT_STALL_MS);
+  Serial.printf("Reset: %s (boot %u, %u crumbs)\n", resetReasonName(resetReason),
+                (unsigned)stallLog.boots, (unsigned)stallLog.count);
+
+  // before anything can publish; events queue until the tasks run
+  bus.begin(busWake);
+  bus.subscribe(BC_UI, 1u << BUS_SAMPLE | 1u << BUS_BUTTON | 1u << BUS_WIFI | 1u << BUS_CONFIG);
+  bus.subscribe(BC_NET, 1u << BUS_SAMPLE | 1u << BUS_WIFI | 1u << BUS_CONFIG | 1u << BUS_LINK);
+
+  buttonsBegin();
+  boot.mark("init");
+
+  // settings and calibration first: the sampler uses them
+  loadMqtt();
+  mqttShow();
+  mqtt.setSocketTimeout(1);          // ✅ key fix: reduce blocking time
+  if (!mqtt.setBufferSize(MQTT_PACKET_LEN)){
+    Serial.println("MQTT buffer alloc failed, large payloads are dropped");
+  }
+  loadAdcCfg();
+  loadSampling();
+  loadLcdCfg();
+  loadEcCal();
+  loadLevelCal();
+  loadDs18Slots();
+  computeEcCal();
+  computeLevelCal();
+  boot.mark("nvs");
+
+  analogReadResolution(12);
+  adcBuildLuts();
+  if (!adcSampler.begin(adcPins, adcSlots, ADC_FRAME_BYTES)){
+    Serial.println("ADC DMA init failed, using analogRead()");
   }
+  applyAdcOversample(adcOsCfg);
 
-  // MQTT LAST (never let it block buttons)
-  if (now - lastMqtt >= TICK_MQTT_MS){
-    lastMqtt = now;
-    mqttEnsure();
-    mqtt.loop();
-    mqttPublish();
+  if (!sampleTimerStart()){
+    Serial.println("Sample timer failed, sampling from the acq task");
   }
+#if HYDRO_MUX_INPUTS > 0
+  muxBegin();
+#endif
+  boot.mark("sampler");
+
+  // no waiting for WiFi: the net task finishes STA/AP selection
+  WiFi.onEvent(onWiFiEvent);
+  startSTA();
+  boot.mark("wifi");
+
+  // LittleFS is mounted by the first static request (fsMount())
+  setupRoutes();
+  server.begin();
+  boot.mark("http");
+
+  // LCD and DS18B20 init run at the start of their tasks, in parallel
+  // with each other and the WiFi connect
+  if (!tasksStart()){
+    Serial.println("Task start failed, restarting");
+    delay(1000);
+    ESP.restart();
+  }
+  boot.mark("tasks");
+
+  for (uint8_t i=0;i<boot.phases();i++){
+    uint32_t us = boot.phaseUs(i);
+    Serial.printf("boot: %-13s %5lu.%lu ms\n", boot.phaseName(i),
+                  (unsigned long)(us / 1000), (unsigned long)(us / 100 % 10));
+  }
+}
+
+// All work runs in the tasks started by setup()
+void loop(){
+  vTaskDelete(NULL);
 }
@@ -0,0 +1,117 @@
+// Cost of one calibrated conversion: the float path the sketch used
+// before the fixed-point pipeline vs LinearQ32::apply().
+//
+//   pio test -e native -f bench_fixed_point      (ns on the host FPU)
+//   pio test -e esp32c3 -f bench_fixed_point     (CPU cycles, soft-float)
+#include <unity.h>
+#include <stdio.h>
+
+#include "fixed_point.h"
+#include "profiler.h"
+
+#ifdef ARDUINO
+static const char* const UNIT = "cycles";
+static const uint32_t ROUNDS = 4;
+#else
+static const char* const UNIT = "ns";
+static const uint32_t ROUNDS = 400;
+#endif
+
+static const size_t N_IN = 256;
+
+// EC calibration points: uS/cm at probe uV
+static const int32_t A_UV = 450000, A_EC = 1413;
+static const int32_t B_UV = 2400000, B_EC = 27600;
+
+static int32_t inUv[N_IN];
+static volatile int32_t sink;
+
+// Pre-fixed-point path: volts as float, slope/offset as float
+struct LinearFloat {
+  float slope;
+  float offset;
+  void fit(float x0, float y0, float x1, float y1){
+    slope = (y1 - y0) / (x1 - x0);
+    offset = y0 - slope * x0;
+  }
+};
+
+static LinearFloat fl;
+static LinearQ32 fq;
+
+void setUp(void){}
+void tearDown(void){}
+
+static int32_t floatConvert(int32_t uv){
+  float v = (float)uv / 1000000.0f;
+  return fxFromFloat(fl.slope * v + fl.offset, 1);
+}
+
+static void report(const char* name, uint32_t cycles, uint32_t n){
+  char msg[80];
+  uint32_t x10 = (uint32_t)((uint64_t)cycles * 10 / n);
+  snprintf(msg, sizeof(msg), "%-10s %lu.%lu %s/conversion", name,
+           (unsigned long)(x10 / 10), (unsigned long)(x10 % 10), UNIT);
+  TEST_MESSAGE(msg);
+}
+
+static void test_setup_inputs(void){
+  uint32_t r = 12345;
+  for (size_t i = 0; i < N_IN; i++) {
+    r = r * 1664525u + 1013904223u;
+    inUv[i] = (int32_t)(r % 3100000u);   // 0 .. 3.1 V
+  }
+  fl.fit(A_UV / 1e6f, (float)A_EC, B_UV / 1e6f, (float)B_EC);
+  TEST_ASSERT_TRUE(fq.fit(A_UV, A_EC, B_UV, B_EC));
+}
+
+// Same results within float rounding
+static void test_paths_agree(void){
+  for (size_t i = 0; i < N_IN; i++) {
+    TEST_ASSERT_INT32_WITHIN(1, floatConvert(inUv[i]), fq.apply(inUv[i]));
+  }
+  TEST_ASSERT_EQUAL_INT32(A_EC, fq.apply(A_UV));
+  TEST_ASSERT_EQUAL_INT32(B_EC, fq.apply(B_UV));
+}
+
+static void test_bench_float_vs_q32(void){
+  const uint32_t n = ROUNDS * N_IN;
+  int32_t acc = 0;
+
+  uint32_t t0 = profCycles();
+  for (uint32_t k = 0; k < ROUNDS; k++)
+    for (size_t i = 0; i < N_IN; i++) acc += floatConvert(inUv[i] + (int32_t)k);
+  uint32_t tFloat = profCycles() - t0;
+  sink = acc;
+
+  acc = 0;
+  t0 = profCycles();
+  for (uint32_t k = 0; k < ROUNDS; k++)
+    for (size_t i = 0; i < N_IN; i++) acc += fq.apply(inUv[i] + (int32_t)k);
+  uint32_t tQ32 = profCycles() - t0;
+  sink = acc;
+
+  report("float", tFloat, n);
+  report("LinearQ32", tQ32, n);
+}
+
+static int runAll(void){
+  UNITY_BEGIN();
+  RUN_TEST(test_setup_inputs);
+  RUN_TEST(test_paths_agree);
+  RUN_TEST(test_bench_float_vs_q32);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup(){
+  delay(2000);   // USB CDC
+  runAll();
+}
+
+void loop(){}
+#else
+int main(int, char**){
+  return runAll();
+}
+#endif
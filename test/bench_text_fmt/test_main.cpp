@@ -0,0 +1,153 @@
+// Cost of formatting an LCD line and an MQTT value: TextBuf vs the
+// snprintf path it replaced (and Arduino String on the board).
+//
+//   pio test -e native -f bench_text_fmt      (ns on the host)
+//   pio test -e esp32c3 -f bench_text_fmt     (CPU cycles, soft-float printf)
+#include <unity.h>
+#include <stdio.h>
+
+#include "text_fmt.h"
+#include "profiler.h"
+
+#ifdef ARDUINO
+static const char* const UNIT = "cycles";
+static const uint32_t ROUNDS = 2;
+#else
+static const char* const UNIT = "ns";
+static const uint32_t ROUNDS = 200;
+#endif
+
+static const size_t N_IN = 256;
+
+// Home screen inputs: EC in uS/cm, temperature in 1/100 C, level in 1/100 %
+static int32_t ecUs[N_IN];
+static int32_t tCx100[N_IN];
+static int32_t pctX100[N_IN];
+static volatile uint32_t sink;
+
+void setUp(void){}
+void tearDown(void){}
+
+// "EC 1.41mS T 23.5C" / "Water  57.3%"
+static size_t lcdFixed(char* out, size_t cap, size_t i){
+  TextBuf t(out, cap);
+  t.str("EC").fx(ecUs[i], 1000, 2, 5).str("mS T").fx(tCx100[i], 100, 1, 5).ch('C');
+  return t.length();
+}
+
+static size_t lcdPrintf(char* out, size_t cap, size_t i){
+  return (size_t)snprintf(out, cap, "EC%5.2fmS T%5.1fC", ecUs[i] / 1000.0f, tCx100[i] / 100.0f);
+}
+
+static size_t mqttFixed(char* out, size_t cap, size_t i){
+  return TextBuf(out, cap).fx(pctX100[i], 100, 1).length();
+}
+
+static size_t mqttPrintf(char* out, size_t cap, size_t i){
+  return (size_t)snprintf(out, cap, "%.1f", pctX100[i] / 100.0f);
+}
+
+#ifdef ARDUINO
+static size_t lcdString(char* out, size_t cap, size_t i){
+  String s = "EC" + String(ecUs[i] / 1000.0f, 2) + "mS T" + String(tCx100[i] / 100.0f, 1) + "C";
+  strlcpy(out, s.c_str(), cap);
+  return s.length();
+}
+
+static size_t mqttString(char* out, size_t cap, size_t i){
+  String s(pctX100[i] / 100.0f, 1);
+  strlcpy(out, s.c_str(), cap);
+  return s.length();
+}
+#endif
+
+// One decimal digit past the shown ones; printf rounds exact .5 ties
+// of the binary float, TextBuf rounds them away from zero
+static bool tie(int32_t v){
+  return (v < 0 ? -v : v) % 10 == 5;
+}
+
+static void test_setup_inputs(void){
+  uint32_t r = 777;
+  for (size_t i = 0; i < N_IN; i++) {
+    r = r * 1664525u + 1013904223u;
+    ecUs[i] = (int32_t)(r % 30000u);
+    r = r * 1664525u + 1013904223u;
+    tCx100[i] = (int32_t)(r % 6000u) - 1000;   // -10 .. 50 C
+    r = r * 1664525u + 1013904223u;
+    pctX100[i] = (int32_t)(r % 10001u);
+  }
+}
+
+static void test_same_text_as_printf(void){
+  char a[32], b[32];
+  for (size_t i = 0; i < N_IN; i++) {
+    if (!tie(ecUs[i]) && !tie(tCx100[i])) {
+      lcdFixed(a, sizeof(a), i);
+      lcdPrintf(b, sizeof(b), i);
+      TEST_ASSERT_EQUAL_STRING(b, a);
+    }
+    if (!tie(pctX100[i])) {
+      mqttFixed(a, sizeof(a), i);
+      mqttPrintf(b, sizeof(b), i);
+      TEST_ASSERT_EQUAL_STRING(b, a);
+    }
+  }
+}
+
+typedef size_t (*FormatFn)(char*, size_t, size_t);
+
+static void bench(const char* name, FormatFn fn){
+  char out[32];
+  uint32_t acc = 0;
+  uint32_t t0 = profCycles();
+  for (uint32_t k = 0; k < ROUNDS; k++)
+    for (size_t i = 0; i < N_IN; i++) acc += fn(out, sizeof(out), i) + (uint8_t)out[2];
+  uint32_t t = profCycles() - t0;
+  sink = acc;
+
+  char msg[80];
+  uint32_t n = ROUNDS * N_IN;
+  uint32_t x10 = (uint32_t)((uint64_t)t * 10 / n);
+  snprintf(msg, sizeof(msg), "%-14s %lu.%lu %s/text", name,
+           (unsigned long)(x10 / 10), (unsigned long)(x10 % 10), UNIT);
+  TEST_MESSAGE(msg);
+}
+
+static void test_bench_lcd_line(void){
+  bench("lcd snprintf", lcdPrintf);
+#ifdef ARDUINO
+  bench("lcd String", lcdString);
+#endif
+  bench("lcd TextBuf", lcdFixed);
+}
+
+static void test_bench_mqtt_value(void){
+  bench("mqtt snprintf", mqttPrintf);
+#ifdef ARDUINO
+  bench("mqtt String", mqttString);
+#endif
+  bench("mqtt TextBuf", mqttFixed);
+}
+
+static int runAll(void){
+  UNITY_BEGIN();
+  RUN_TEST(test_setup_inputs);
+  RUN_TEST(test_same_text_as_printf);
+  RUN_TEST(test_bench_lcd_line);
+  RUN_TEST(test_bench_mqtt_value);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup(){
+  delay(2000);   // USB CDC
+  runAll();
+}
+
+void loop(){}
+#else
+int main(int, char**){
+  return runAll();
+}
+#endif
@@ -0,0 +1,133 @@
+// AdcSampler reduction path on the host stub (pio test -e native)
+#include <unity.h>
+
+#include "adc_sampler.h"
+
+static const size_t RING = 8;
+typedef AdcSampler<2, RING> Sampler;
+
+static const int PINS[2] = { 0, 1 };
+static Sampler adc;
+
+void setUp(void){
+  adc.begin(PINS);
+}
+
+void tearDown(void){}
+
+static void test_mean_empty_channel(void){
+  uint16_t v = 1234;
+  TEST_ASSERT_FALSE(adc.mean(0, 4, v));
+  TEST_ASSERT_EQUAL_UINT16(1234, v);
+  TEST_ASSERT_FALSE(adc.mean(2, 4, v));   // no such channel
+}
+
+static void test_mean_newest_and_rounded(void){
+  adc.inject(0, 100);
+  adc.inject(0, 200);
+  adc.inject(0, 301);
+  adc.inject(1, 4000);
+
+  uint16_t v = 0;
+  TEST_ASSERT_TRUE(adc.mean(0, 2, v));
+  TEST_ASSERT_EQUAL_UINT16(251, v);       // (200 + 301) / 2, rounded
+  TEST_ASSERT_TRUE(adc.mean(0, 100, v));  // clamped to the 3 available
+  TEST_ASSERT_EQUAL_UINT16(200, v);
+  TEST_ASSERT_TRUE(adc.mean(1, 1, v));
+  TEST_ASSERT_EQUAL_UINT16(4000, v);
+}
+
+static void test_mean_masks_to_12_bits(void){
+  adc.inject(0, 0xF123);
+  uint16_t v = 0;
+  TEST_ASSERT_TRUE(adc.mean(0, 1, v));
+  TEST_ASSERT_EQUAL_UINT16(0x123, v);
+}
+
+static void test_mean_after_ring_wrap(void){
+  for (uint16_t i = 1; i <= RING + 3; i++) adc.inject(0, i);
+  uint16_t v = 0;
+  TEST_ASSERT_TRUE(adc.mean(0, RING, v));  // samples 4..11
+  TEST_ASSERT_EQUAL_UINT16((4 + 11 + 1) / 2, v);
+}
+
+static uint16_t seen[4 * RING];
+static size_t nSeen;
+
+static void collect(uint16_t v){ seen[nSeen++] = v; }
+
+static void test_consume_in_order(void){
+  uint32_t cursor = 0;
+  nSeen = 0;
+  adc.inject(0, 10);
+  adc.inject(0, 11);
+  TEST_ASSERT_EQUAL(2, adc.consume(0, cursor, collect));
+  adc.inject(0, 12);
+  TEST_ASSERT_EQUAL(1, adc.consume(0, cursor, collect));
+  TEST_ASSERT_EQUAL(0, adc.consume(0, cursor, collect));
+
+  TEST_ASSERT_EQUAL(3, nSeen);
+  for (size_t i = 0; i < 3; i++) TEST_ASSERT_EQUAL_UINT16(10 + i, seen[i]);
+  TEST_ASSERT_EQUAL_UINT32(3, cursor);
+}
+
+static void test_consume_wraps_past_ring(void){
+  uint32_t cursor = 0;
+  nSeen = 0;
+
+  // keeps up across several laps of the ring
+  for (uint16_t i = 0; i < 3 * RING; i++) {
+    adc.inject(1, i);
+    if (i % 3 == 2) adc.consume(1, cursor, collect);
+  }
+  adc.consume(1, cursor, collect);
+  TEST_ASSERT_EQUAL(3 * RING, nSeen);
+  for (size_t i = 0; i < nSeen; i++) TEST_ASSERT_EQUAL_UINT16(i, seen[i]);
+  TEST_ASSERT_EQUAL_UINT32(3 * RING, cursor);
+}
+
+static void test_consume_behind_sees_retained_only(void){
+  uint32_t cursor = 0;
+  nSeen = 0;
+
+  // RING + 5 pushed without a read: the 5 oldest are overwritten
+  for (uint16_t i = 0; i < RING + 5; i++) adc.inject(0, 100 + i);
+  TEST_ASSERT_EQUAL(RING, adc.consume(0, cursor, collect));
+  TEST_ASSERT_EQUAL(RING, nSeen);
+  TEST_ASSERT_EQUAL_UINT16(105, seen[0]);
+  TEST_ASSERT_EQUAL_UINT16(100 + RING + 4, seen[RING - 1]);
+  TEST_ASSERT_EQUAL_UINT32(RING + 5, cursor);   // lost samples are skipped, not replayed
+}
+
+static void test_overrun_counted_once_per_poll(void){
+  TEST_ASSERT_EQUAL_UINT32(0, adc.overrunCount());
+  adc.poll();
+  TEST_ASSERT_EQUAL_UINT32(0, adc.overrunCount());
+
+  adc.injectOverrun();
+  adc.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, adc.overrunCount());
+  adc.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, adc.overrunCount());
+
+  adc.injectOverrun();
+  adc.injectOverrun();   // one overflow state, one count
+  adc.poll();
+  TEST_ASSERT_EQUAL_UINT32(2, adc.overrunCount());
+
+  adc.begin(PINS);
+  TEST_ASSERT_EQUAL_UINT32(0, adc.overrunCount());
+}
+
+int main(int, char**){
+  UNITY_BEGIN();
+  RUN_TEST(test_mean_empty_channel);
+  RUN_TEST(test_mean_newest_and_rounded);
+  RUN_TEST(test_mean_masks_to_12_bits);
+  RUN_TEST(test_mean_after_ring_wrap);
+  RUN_TEST(test_consume_in_order);
+  RUN_TEST(test_consume_wraps_past_ring);
+  RUN_TEST(test_consume_behind_sees_retained_only);
+  RUN_TEST(test_overrun_counted_once_per_poll);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+// MuxScanner over the host AdcSampler stub and SimMux (pio test -e native)
+#include <unity.h>
+
+#include "adc_sampler.h"
+#include "analog_mux.h"
+
+// Same layout as the sketch with HYDRO_MUX_INPUTS=16: EC, level and
+// the mux pin with 6 of 8 pattern slots, one pattern pass per frame
+enum { CH_EC = 0, CH_LEVEL = 1, CH_MUX = 2, CH_N };
+static const uint8_t  INPUTS      = 16;
+static const uint8_t  MUX_SLOTS   = 6;
+static const uint32_t FRAME_BYTES = (2 + MUX_SLOTS) * ADC_DMA_RESULT_BYTES;
+static const uint32_t SETTLE_US   = 400;
+static const uint16_t DWELL       = 16;
+
+static const int PINS[CH_N] = { 0, 1, 2 };
+static const uint8_t SLOTS[CH_N] = { 1, 1, MUX_SLOTS };
+
+static AdcSampler<CH_N> adc;
+
+static uint16_t levelOf(uint8_t input){ return (uint16_t)(200 + 150 * input); }
+
+// The DMA hands a conversion over only once the frame it sits in is
+// complete: model that as a FIFO of inFlight() samples between the
+// mux output and the sampler ring.
+struct Stream {
+  SimMux &mux;
+  uint16_t delay[64];
+  uint32_t depth;
+  uint32_t n = 0;
+
+  Stream(SimMux &m, uint32_t inFlight) : mux(m), depth(inFlight) {}
+
+  void convert(uint32_t count){
+    for (uint32_t i = 0; i < count; i++) {
+      uint16_t v = mux.convert();
+      if (n >= depth) adc.inject(CH_MUX, delay[n % depth]);   // converted `depth` ago
+      delay[n++ % depth] = v;
+    }
+  }
+};
+
+void setUp(void){
+  TEST_ASSERT_TRUE(adc.begin(PINS, SLOTS, FRAME_BYTES));
+}
+
+void tearDown(void){}
+
+static uint16_t discardForLayout(void){
+  return muxDiscardSamples(adc.inFlight(CH_MUX), adc.channelHz(CH_MUX), SETTLE_US);
+}
+
+// Settle samples at the mux pin's conversion rate: 6 kHz * 400 us
+static uint16_t settleSamples(void){
+  return (uint16_t)(discardForLayout() - adc.inFlight(CH_MUX));
+}
+
+static void test_discard_samples_formula(void){
+  TEST_ASSERT_EQUAL_UINT16(0, muxDiscardSamples(0, 6000, 0));
+  TEST_ASSERT_EQUAL_UINT16(4, muxDiscardSamples(4, 6000, 0));
+  TEST_ASSERT_EQUAL_UINT16(1, muxDiscardSamples(0, 1000, 1));     // rounds up
+  TEST_ASSERT_EQUAL_UINT16(1, muxDiscardSamples(0, 1000, 1000));
+  TEST_ASSERT_EQUAL_UINT16(2, muxDiscardSamples(0, 1000, 1001));
+
+  // sketch layout: 6 mux samples per frame in flight + ceil(2.4) settle
+  TEST_ASSERT_EQUAL_UINT32(6000, adc.channelHz(CH_MUX));
+  TEST_ASSERT_EQUAL_UINT32(6, adc.inFlight(CH_MUX));
+  TEST_ASSERT_EQUAL_UINT16(9, discardForLayout());
+}
+
+// Runs `steps` scanner steps of one frame each; logs every input the
+// scanner selects, in order
+static void runScan(MuxScanner<INPUTS, SimMux> &scan, SimMux &mux, Stream &s, uint32_t steps,
+                    uint8_t *order, uint32_t orderMax, uint32_t &logged){
+  logged = 0;
+  uint32_t selects = mux.selectCount();
+  for (uint32_t i = 0; i < steps; i++) {
+    s.convert(MUX_SLOTS);
+    scan.step(adc, CH_MUX);
+    if (mux.selectCount() != selects) {
+      TEST_ASSERT_EQUAL_UINT32(selects + 1, mux.selectCount());   // at most one switch per step
+      selects = mux.selectCount();
+      if (logged < orderMax) order[logged++] = mux.selected();
+    }
+  }
+}
+
+static void test_scan_order_and_settled_values(void){
+  SimMux mux(settleSamples());
+  for (uint8_t i = 0; i < INPUTS; i++) mux.set(i, levelOf(i));
+  Stream s(mux, adc.inFlight(CH_MUX));
+  MuxScanner<INPUTS, SimMux> scan(mux);
+
+  scan.begin(discardForLayout(), DWELL);
+  TEST_ASSERT_EQUAL_UINT16(9, scan.discardCount());
+  TEST_ASSERT_EQUAL_UINT8(0, mux.selected());
+
+  uint8_t order[3 * INPUTS];
+  uint32_t n = 0;
+  runScan(scan, mux, s, 400, order, sizeof(order), n);
+
+  // 0, 1, ..., 15, 0, 1, ...
+  TEST_ASSERT_TRUE(n >= 2 * INPUTS);
+  for (uint32_t i = 0; i < n; i++) TEST_ASSERT_EQUAL_UINT8((i + 1) % INPUTS, order[i]);
+  TEST_ASSERT_TRUE(scan.scanCount() >= 2);
+
+  // every dwell average saw the settled level of its own input only
+  for (uint8_t i = 0; i < INPUTS; i++) {
+    TEST_ASSERT_EQUAL_UINT16(levelOf(i), scan.value(i));
+    TEST_ASSERT_TRUE(scan.updateCount(i) >= scan.scanCount());
+  }
+}
+
+// One discarded sample short and the average picks up the previous
+// input through the settling tail
+static void test_short_discard_leaks_previous_input(void){
+  SimMux mux(settleSamples());
+  for (uint8_t i = 0; i < INPUTS; i++) mux.set(i, levelOf(i));
+  Stream s(mux, adc.inFlight(CH_MUX));
+  MuxScanner<INPUTS, SimMux> scan(mux);
+
+  scan.begin(discardForLayout() - 1, DWELL);
+  uint8_t order[1];
+  uint32_t n = 0;
+  runScan(scan, mux, s, 400, order, 0, n);
+  TEST_ASSERT_TRUE(scan.scanCount() >= 2);
+
+  uint8_t wrong = 0;
+  for (uint8_t i = 1; i < INPUTS; i++) if (scan.value(i) < levelOf(i)) wrong++;
+  TEST_ASSERT_EQUAL_UINT8(INPUTS - 1, wrong);
+}
+
+// Samples buffered before begin() belong to no input
+static void test_first_step_drops_backlog(void){
+  SimMux mux(0);
+  for (uint8_t i = 0; i < INPUTS; i++) mux.set(i, levelOf(i));
+  for (uint16_t i = 0; i < 100; i++) adc.inject(CH_MUX, 4095);
+
+  MuxScanner<INPUTS, SimMux> scan(mux);
+  scan.begin(0, DWELL);
+  TEST_ASSERT_FALSE(scan.step(adc, CH_MUX));
+
+  for (uint16_t i = 0; i < DWELL; i++) adc.inject(CH_MUX, mux.convert());
+  scan.step(adc, CH_MUX);
+  TEST_ASSERT_EQUAL_UINT16(levelOf(0), scan.value(0));
+  TEST_ASSERT_EQUAL_UINT8(1, scan.current());
+}
+
+int main(int, char**){
+  UNITY_BEGIN();
+  RUN_TEST(test_discard_samples_formula);
+  RUN_TEST(test_scan_order_and_settled_values);
+  RUN_TEST(test_short_discard_leaks_previous_input);
+  RUN_TEST(test_first_step_drops_backlog);
+  return UNITY_END();
+}